@@ -0,0 +1,81 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stdint.h>
+#include "serial.h"
+#include "slcan.h"
+#include "dispatch.h"
+#include "script.h"
+#include "can_bus.h"
+
+/**
+ * Every buffer whose depth is a trade-off (queues, capture buffers, tables,
+ * caches) lives in one static arena instead of its own global, so the
+ * RAM they take is accounted for in one place.
+ *
+ * A client is one line of ARENA_CLIENTS:
+ *
+ *   X(id, field, element type, element count, name)
+ *
+ * The owning module reaches its buffer as arena.field and reports how much
+ * of it was used with Arena_Mark. The build fails when the clients add up
+ * to more than ARENA_BUDGET_BYTES, so growing one buffer means shrinking
+ * another or raising the budget on purpose.
+ */
+#define ARENA_CLIENTS(X) \
+	X(ARENA_SERIAL_RX, serial_rx, uint8_t, SERIAL_RX_BUFFER_SIZE, "serial rx ring") \
+	X(ARENA_SERIAL_TX, serial_tx, uint8_t, 2 * SERIAL_TX_BUFFER_SIZE, "serial tx buffers") \
+	X(ARENA_SLCAN_BATCH, slcan_batch, uint8_t, SLCAN_RX_BATCH * SLCAN_MAX_ENCODED, "slcan rx batch") \
+	X(ARENA_DISPATCH, dispatch_table, DISPATCH_ENTRY_T, DISPATCH_TABLE_SIZE, "dispatch table") \
+	X(ARENA_SCRIPT, script, uint8_t, SCRIPT_MAX_SIZE, "test script") \
+	X(ARENA_CAN_TX_QUEUE, can_tx_queue, CAN_BUS_TX_ENTRY_T, CAN_BUS_TX_QUEUE_SIZE, "can tx queue")
+
+// what's left of the 7904 byte RAM region after .data, the rest of .bss,
+// .ramfunc and the stack, with some headroom
+#ifndef ARENA_BUDGET_BYTES
+    #define ARENA_BUDGET_BYTES 1536
+#endif
+
+// fill pattern for the unused RAM below the stack
+#define ARENA_STACK_PAINT 0xC5C5C5C5UL
+
+#define ARENA_ID(id, field, type, count, name) id,
+typedef enum {
+	ARENA_CLIENTS(ARENA_ID)
+	ARENA_CLIENT_COUNT
+} ARENA_CLIENT_T;
+#undef ARENA_ID
+
+#define ARENA_FIELD(id, field, type, count, name) type field[count];
+typedef struct {
+	ARENA_CLIENTS(ARENA_FIELD)
+} ARENA_T;
+#undef ARENA_FIELD
+
+typedef char arena_within_budget[(sizeof(ARENA_T) <= ARENA_BUDGET_BYTES) ? 1 : -1];
+
+extern ARENA_T arena;
+
+/**
+ * @details clears the high-water marks and paints the free RAM between the
+ * heap and the current stack pointer, so Arena_Dump can tell how deep the
+ * stack has been. Call first thing in main, before interrupts are enabled.
+ */
+void Arena_Init(void);
+
+/**
+ * @details raises the high-water mark of a client. Safe to call from
+ * interrupts, each client is only marked from one context.
+ *
+ * @param client client whose buffer was filled
+ * @param used_bytes bytes of its buffer in use right now
+ */
+void Arena_Mark(ARENA_CLIENT_T client, uint32_t used_bytes);
+
+/**
+ * @details prints the size and high-water mark of every client, the arena
+ * total against its budget, and the stack high-water mark
+ */
+void Arena_Dump(void);
+
+#endif
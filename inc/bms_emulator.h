@@ -0,0 +1,97 @@
+#ifndef _BMS_EMULATOR_H_
+#define _BMS_EMULATOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+	BMS_EMULATOR_SOC,
+	BMS_EMULATOR_PACK_VOLTAGE,
+	BMS_EMULATOR_PACK_CURRENT,
+	BMS_EMULATOR_AVE_CELL_VOLTAGE,
+	BMS_EMULATOR_MIN_CELL_VOLTAGE,
+	BMS_EMULATOR_MAX_CELL_VOLTAGE,
+	BMS_EMULATOR_AVE_CELL_TEMP,
+	BMS_EMULATOR_MIN_CELL_TEMP,
+	BMS_EMULATOR_MAX_CELL_TEMP,
+	BMS_EMULATOR_SIGNAL_COUNT
+} BMS_EMULATOR_SIGNAL_T;
+
+typedef enum {
+	BMS_EMULATOR_CONSTANT,	// always from
+	BMS_EMULATOR_RAMP,	// from to to over each period, then jumps back
+	BMS_EMULATOR_TRIANGLE,	// from to to over half a period and back
+	BMS_EMULATOR_SQUARE	// from for half a period, to for the other half
+} BMS_EMULATOR_SHAPE_T;
+
+typedef struct {
+	uint8_t shape;
+	uint16_t from;
+	uint16_t to;
+	uint32_t period_ms;
+} BMS_EMULATOR_TRAJECTORY_T;
+
+// period of messages whose __freq in can_constants.h is 0 or negative
+#define BMS_EMULATOR_FALLBACK_PERIOD_MS 1000
+#define BMS_EMULATOR_DEFAULT_RESPONSE_LATENCY_MS 10
+
+/**
+ * @details stops the emulator, restores the default trajectories and
+ * response latency and clears the latency statistics
+ */
+void BmsEmulator_Init(void);
+
+/**
+ * @details starts or stops emulating the BMS. Starting restarts every
+ * trajectory and puts the emulated BMS in Standby.
+ *
+ * @param enable true to start emulating
+ */
+void BmsEmulator_SetActive(bool enable);
+
+/**
+ * @return true if the BMS is being emulated
+ */
+bool BmsEmulator_IsActive(void);
+
+/**
+ * @param signal signal to script
+ * @param trajectory values the signal follows from the moment the emulator starts
+ */
+void BmsEmulator_SetTrajectory(BMS_EMULATOR_SIGNAL_T signal, const BMS_EMULATOR_TRAJECTORY_T * trajectory);
+
+/**
+ * @param latency_ms time between receiving a discharge request and sending the response
+ */
+void BmsEmulator_SetResponseLatency(uint16_t latency_ms);
+
+/**
+ * @return time between receiving a discharge request and sending the response
+ */
+uint16_t BmsEmulator_GetResponseLatency(void);
+
+/**
+ * @details schedules a BMS_DISCHARGE_RESPONSE after the response latency.
+ * Called by the VCU_DISCHARGE_REQUEST handler; a request arriving while a
+ * response is still pending is answered by that response.
+ *
+ * @param rx_cycles Timebase_GetCycles reading when the request was
+ * received, the latency counts from there
+ */
+void BmsEmulator_DischargeRequested(uint32_t rx_cycles);
+
+/**
+ * @details sends the pending discharge response once its latency has
+ * elapsed and at most one periodic message that is due
+ *
+ * @return true if a message was sent
+ */
+bool BmsEmulator_Update(void);
+
+/**
+ * @details prints the emulated state and the measured response latency,
+ * from dispatch of the request to hand-off of the response to the CAN controller
+ */
+void BmsEmulator_Dump(void);
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef _CAN_BUS_H_
+#define _CAN_BUS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ccand_11xx.h"
+#include "chip.h"
+#include "ramfunc.h"
+
+// message objects above the ones used by the CAN library: one receives
+// every 29 bit identifier, the others are fed from the transmit queue
+#define CAN_BUS_EXT_RX_MSGOBJ 28
+#define CAN_BUS_TX_MSGOBJ_FIRST 29
+#define CAN_BUS_TX_MSGOBJ_COUNT 3
+
+// frames waiting for a free transmit message object
+#define CAN_BUS_TX_QUEUE_SIZE 16
+
+// receive times of the frames waiting in the CAN library's buffer, at least
+// as many as that buffer holds
+#define CAN_BUS_RX_STAMP_COUNT 16
+
+// bit rates the tester is configured for and auto-baud tries, most common first
+#define CAN_BUS_DEFAULT_BITRATE 500000
+#define CAN_BUS_BITRATES {500000, 250000, 125000, 1000000}
+#define CAN_BUS_BITRATE_COUNT 4
+
+// auto-baud settles on a rate once this many frames decode without a bus
+// error, and moves on after the dwell time or the first error
+#define CAN_BUS_AUTOBAUD_MIN_FRAMES 2
+#define CAN_BUS_AUTOBAUD_DWELL_MS 250
+#define CAN_BUS_AUTOBAUD_ROUNDS 8
+
+#define CAN_BUS_MAX_STD_ID 0x7FF
+#define CAN_BUS_MAX_EXT_ID 0x1FFFFFFF
+#define CAN_BUS_MAX_DLC 8
+
+typedef struct {
+	uint32_t mode_id;
+	uint32_t queued_cycles;
+	uint8_t dlc;
+	uint8_t data[CAN_BUS_MAX_DLC];
+} CAN_BUS_TX_ENTRY_T;
+
+typedef struct {
+	uint32_t queued;
+	uint32_t sent;
+	uint32_t dropped;
+	uint8_t max_depth;
+	// kept in cycles, converting divides and that belongs in the main loop
+	uint32_t min_latency_cycles;
+	uint32_t max_latency_cycles;
+	uint64_t total_latency_cycles;
+} CAN_BUS_TX_STATS_T;
+
+typedef enum {
+	CAN_BUS_AUTOBAUD_IDLE,
+	CAN_BUS_AUTOBAUD_RUNNING,
+	CAN_BUS_AUTOBAUD_FOUND,
+	CAN_BUS_AUTOBAUD_FAILED
+} CAN_BUS_AUTOBAUD_T;
+
+/**
+ * @details initializes the CAN peripheral through the CAN library, adds a
+ * receive message object that accepts every 29 bit identifier and empties
+ * the transmit queue
+ *
+ * @param bitrate CAN bit rate in bit/s
+ * @param listen_only true to never acknowledge or send frames
+ */
+void CanBus_Init(uint32_t bitrate, bool listen_only);
+
+/**
+ * @details resets the CAN peripheral and initializes it again with the
+ * current settings. Queued frames and frames still in the message objects
+ * are counted as dropped.
+ */
+void CanBus_Reset(void);
+
+/**
+ * @details changes the bit rate and listen-only mode. A new bit rate resets
+ * the peripheral as CanBus_Reset does, listen-only mode alone is switched
+ * in place.
+ *
+ * Listen-only uses the controller's silent test mode: it receives without
+ * driving a single dominant bit, so no ACK, error frame or transmission
+ * reaches the bus. Transmissions are refused while it is on.
+ *
+ * @param bitrate CAN bit rate in bit/s
+ * @param listen_only true to never acknowledge or send frames
+ */
+void CanBus_Configure(uint32_t bitrate, bool listen_only);
+
+/**
+ * @return current CAN bit rate in bit/s
+ */
+uint32_t CanBus_GetBitrate(void);
+
+/**
+ * @return true while listen-only mode is on
+ */
+bool CanBus_IsListenOnly(void);
+
+/**
+ * @param bitrate bit rate in bit/s
+ * @return true if bitrate is one of CAN_BUS_BITRATES
+ */
+bool CanBus_IsStandardBitrate(uint32_t bitrate);
+
+/**
+ * @details starts bit rate detection: each of CAN_BUS_BITRATES is tried in
+ * listen-only mode, so a wrong guess never disturbs the bus, until frames
+ * decode without errors or CAN_BUS_AUTOBAUD_ROUNDS rounds pass. While it
+ * runs CanBus_UpdateAutoBaud reads and discards every received frame.
+ */
+void CanBus_StartAutoBaud(void);
+
+/**
+ * @details moves detection on, called from the main loop instead of
+ * reading received frames. Once a rate is found it is kept with the
+ * listen-only setting from before detection; if none is, the previous bit
+ * rate is restored.
+ *
+ * @return CAN_BUS_AUTOBAUD_FOUND or CAN_BUS_AUTOBAUD_FAILED once when
+ * detection ends, CAN_BUS_AUTOBAUD_RUNNING before and
+ * CAN_BUS_AUTOBAUD_IDLE after
+ */
+CAN_BUS_AUTOBAUD_T CanBus_UpdateAutoBaud(void);
+
+/**
+ * @details reads the oldest received frame as CAN_Receive does, along with
+ * the time it was received. Every read of received frames must go through
+ * here so the times stay paired with their frames.
+ *
+ * @param msg_obj mutated to hold the frame
+ * @param rx_cycles mutated to hold the Timebase_GetCycles reading taken in
+ * the CAN interrupt when the frame arrived, may be NULL
+ * @return NO_CAN_ERROR, NO_RX_CAN_MESSAGE or error info, as CAN_Receive
+ */
+uint32_t CanBus_Receive(CCAN_MSG_OBJ_T * msg_obj, uint32_t * rx_cycles);
+
+/**
+ * @details every frame the CAN library buffers is stamped, so a stamp not
+ * yet read means a frame is waiting
+ *
+ * @return true if CanBus_Receive has a frame to return
+ */
+bool CanBus_RxPending(void);
+
+/**
+ * @details stands in for RingBuffer_Insert in the CAN library's receive
+ * callback (see the Makefile) to stamp each frame as it is buffered. A
+ * frame is refused, as if the library buffer were full, when there is no
+ * room for its stamp.
+ *
+ * @param ring the library's receive buffer
+ * @param data frame to insert
+ * @return 1 if the frame was inserted, 0 if it was dropped
+ */
+RAMFUNC int CanBus_LibraryRxInsert(RINGBUFF_T * ring, const void * data);
+
+/**
+ * @details queues a standard or extended frame. Frames leave in CAN
+ * priority order (lowest arbitration field first), frames with the same id
+ * in the order they were queued. When the queue is full the lowest priority
+ * frame, possibly this one, is dropped.
+ *
+ * The CAN controller sends the lowest numbered pending message object
+ * first, not the highest priority one, so a frame loaded into an object
+ * can still go out behind a lower priority frame loaded just before it.
+ *
+ * @param mode_id message id, or'ed with CAN_MSGOBJ_EXT for a 29 bit id and
+ * CAN_MSGOBJ_RTR for a remote frame
+ * @param data payload
+ * @param dlc payload length, at most 8
+ * @return false if the frame was dropped, always in listen-only mode
+ */
+bool CanBus_Transmit(uint32_t mode_id, const uint8_t * data, uint8_t dlc);
+
+/**
+ * @details retires message objects whose frame has been sent and loads the
+ * highest priority queued frames into the free ones. CAN_IRQHandler does
+ * the same after every CAN interrupt, so this is only the fallback for a
+ * completion it missed and latency measured here is late by up to 1 ms.
+ * Called from SysTick_Handler.
+ */
+RAMFUNC void CanBus_Poll(void);
+
+/**
+ * @details the CAN library's interrupt handler, renamed for can.o in the
+ * Makefile so CAN_IRQHandler can wrap it
+ */
+void CanBus_LibraryIRQHandler(void);
+
+/**
+ * @details runs the CAN library's handler, then retires the message
+ * objects whose frame went out, counting their latency to the interrupt
+ * the controller raised when transmission succeeded, and refills them from
+ * the queue
+ */
+RAMFUNC void CAN_IRQHandler(void);
+
+/**
+ * @details prints the transmit counters, queue depth and latency to the wire
+ */
+void CanBus_Dump(void);
+
+#endif
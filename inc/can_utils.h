@@ -1,6 +1,20 @@
+#ifndef _CAN_UTILS_H_
+#define _CAN_UTILS_H_
+
 #include <stdint.h>
+#include <stdbool.h>
 #include "chip.h"
 #include "ccand_11xx.h"
+#include "ramfunc.h"
+
+/**
+ * Signal bits are numbered from the most significant bit of the last
+ * payload byte: bit 0 is the top bit of data[7] in an 8 byte frame and of
+ * data[0] in a 1 byte frame. A shorter payload reads as the last dlc bytes
+ * of an 8 byte one, and only carries the signals that end within it (see
+ * CAN_SignalInFrame). Every decoder below takes the length from
+ * msg_obj->dlc; the encoders always build 8 byte frames.
+ */
 
 typedef struct {
 	uint8_t state;
@@ -13,7 +27,7 @@ typedef struct {
  * @param bms_heartbeat datatype that is mutated to store data in msg_obj
  * @param msg_obj datatype containing information about a CAN message
  */
-void CAN_MakeBMSHeartbeat(BMS_HEARTBEAT_T * bms_heartbeat, CCAN_MSG_OBJ_T * msg_obj);
+RAMFUNC void CAN_MakeBMSHeartbeat(BMS_HEARTBEAT_T * bms_heartbeat, CCAN_MSG_OBJ_T * msg_obj);
 
 typedef struct {
 	uint8_t discharge_response;
@@ -25,4 +39,189 @@ typedef struct {
  * @param bms_discharge_response datatype that is mutated to store data in msg_obj
  * @param msg_obj datatype containing information about a CAN message
  */
-void CAN_MakeBMSDischargeResponse(BMS_DISCHARGE_RESPONSE_T * bms_discharge_response, CCAN_MSG_OBJ_T * msg_obj);
+RAMFUNC void CAN_MakeBMSDischargeResponse(BMS_DISCHARGE_RESPONSE_T * bms_discharge_response, CCAN_MSG_OBJ_T * msg_obj);
+
+typedef struct {
+	uint32_t front_right_wheel_speed;
+	uint32_t front_left_wheel_speed;
+} FRONT_CAN_NODE_WHEEL_SPEED_T;
+
+/**
+ * @details translates a CCAN_MSG_OBJ_T into a FRONT_CAN_NODE_WHEEL_SPEED_T
+ *
+ * @param wheel_speed datatype that is mutated to store data in msg_obj
+ * @param msg_obj datatype containing information about a CAN message
+ */
+RAMFUNC void CAN_MakeFrontCanNodeWheelSpeed(FRONT_CAN_NODE_WHEEL_SPEED_T * wheel_speed, CCAN_MSG_OBJ_T * msg_obj);
+
+typedef struct {
+	uint8_t right_accel;
+	uint8_t left_accel;
+	uint8_t front_brake;
+	uint8_t rear_brake;
+	uint8_t steering;
+} FRONT_CAN_NODE_ANALOG_SENSORS_T;
+
+/**
+ * @details translates a CCAN_MSG_OBJ_T into a FRONT_CAN_NODE_ANALOG_SENSORS_T
+ *
+ * @param analog_sensors datatype that is mutated to store data in msg_obj
+ * @param msg_obj datatype containing information about a CAN message
+ */
+RAMFUNC void CAN_MakeFrontCanNodeAnalogSensors(FRONT_CAN_NODE_ANALOG_SENSORS_T * analog_sensors, CCAN_MSG_OBJ_T * msg_obj);
+
+typedef struct {
+	uint16_t pack_voltage;
+	uint16_t pack_current;
+	uint16_t ave_cell_voltage;
+	uint16_t min_cell_voltage;
+	uint8_t min_cell_voltage_id;
+	uint16_t max_cell_voltage;
+	uint8_t max_cell_voltage_id;
+} BMS_PACK_STATUS_T;
+
+/**
+ * @details translates a CCAN_MSG_OBJ_T into a BMS_PACK_STATUS_T
+ *
+ * @param bms_pack_status datatype that is mutated to store data in msg_obj
+ * @param msg_obj datatype containing information about a CAN message
+ */
+RAMFUNC void CAN_MakeBMSPackStatus(BMS_PACK_STATUS_T * bms_pack_status, CCAN_MSG_OBJ_T * msg_obj);
+
+typedef struct {
+	uint8_t ave_cell_temp;
+	uint8_t min_cell_temp;
+	uint8_t min_cell_temp_id;
+	uint8_t max_cell_temp;
+	uint8_t max_cell_temp_id;
+} BMS_CELL_TEMPS_T;
+
+/**
+ * @details translates a CCAN_MSG_OBJ_T into a BMS_CELL_TEMPS_T
+ *
+ * @param bms_cell_temps datatype that is mutated to store data in msg_obj
+ * @param msg_obj datatype containing information about a CAN message
+ */
+RAMFUNC void CAN_MakeBMSCellTemps(BMS_CELL_TEMPS_T * bms_cell_temps, CCAN_MSG_OBJ_T * msg_obj);
+
+/**
+ * @details translates a BMS_HEARTBEAT_T into a CCAN_MSG_OBJ_T, the inverse
+ * of CAN_MakeBMSHeartbeat. Values wider than their signal are truncated.
+ *
+ * @param msg_obj datatype that is mutated to hold the id, dlc and data of the message
+ * @param bms_heartbeat signal values to encode
+ */
+void CAN_EncodeBMSHeartbeat(CCAN_MSG_OBJ_T * msg_obj, const BMS_HEARTBEAT_T * bms_heartbeat);
+
+/**
+ * @details translates a BMS_DISCHARGE_RESPONSE_T into a CCAN_MSG_OBJ_T
+ *
+ * @param msg_obj datatype that is mutated to hold the id, dlc and data of the message
+ * @param bms_discharge_response signal values to encode
+ */
+void CAN_EncodeBMSDischargeResponse(CCAN_MSG_OBJ_T * msg_obj, const BMS_DISCHARGE_RESPONSE_T * bms_discharge_response);
+
+/**
+ * @details translates a BMS_PACK_STATUS_T into a CCAN_MSG_OBJ_T
+ *
+ * @param msg_obj datatype that is mutated to hold the id, dlc and data of the message
+ * @param bms_pack_status signal values to encode
+ */
+void CAN_EncodeBMSPackStatus(CCAN_MSG_OBJ_T * msg_obj, const BMS_PACK_STATUS_T * bms_pack_status);
+
+/**
+ * @details translates a BMS_CELL_TEMPS_T into a CCAN_MSG_OBJ_T
+ *
+ * @param msg_obj datatype that is mutated to hold the id, dlc and data of the message
+ * @param bms_cell_temps signal values to encode
+ */
+void CAN_EncodeBMSCellTemps(CCAN_MSG_OBJ_T * msg_obj, const BMS_CELL_TEMPS_T * bms_cell_temps);
+
+/**
+ * Every signal in can_constants.h as X(message, signal), grouped by message.
+ * Indexes into CAN_Signals are the CAN_SIGNAL_T values, which the host uses
+ * to name signals, so new signals go at the end of their message's group
+ * and new messages at the end of the list.
+ */
+#define CAN_SIGNALS(X) \
+	X(BMS_HEARTBEAT, STATE) \
+	X(BMS_HEARTBEAT, SOC_PERCENTAGE) \
+	X(BMS_DISCHARGE_RESPONSE, DISCHARGE_RESPONSE) \
+	X(BMS_PACK_STATUS, PACK_VOLTAGE) \
+	X(BMS_PACK_STATUS, PACK_CURRENT) \
+	X(BMS_PACK_STATUS, AVE_CELL_VOLTAGE) \
+	X(BMS_PACK_STATUS, MIN_CELL_VOLTAGE) \
+	X(BMS_PACK_STATUS, MIN_CELL_VOLTAGE_ID) \
+	X(BMS_PACK_STATUS, MAX_CELL_VOLTAGE) \
+	X(BMS_PACK_STATUS, MAX_CELL_VOLTAGE_ID) \
+	X(BMS_CELL_TEMPS, AVE_CELL_TEMP) \
+	X(BMS_CELL_TEMPS, MIN_CELL_TEMP) \
+	X(BMS_CELL_TEMPS, MIN_CELL_TEMP_ID) \
+	X(BMS_CELL_TEMPS, MAX_CELL_TEMP) \
+	X(BMS_CELL_TEMPS, MAX_CELL_TEMP_ID) \
+	X(BMS_ERRORS, CELL_UNDER_VOLTAGE_VALUE) \
+	X(BMS_ERRORS, CELL_UNDER_VOLTAGE_ID) \
+	X(BMS_ERRORS, CELL_OVER_VOLTAGE_VALUE) \
+	X(BMS_ERRORS, CELL_OVER_VOLTAGE_ID) \
+	X(BMS_ERRORS, CELL_OVER_TEMP_VALUE) \
+	X(BMS_ERRORS, CELL_OVER_TEMP_ID) \
+	X(FRONT_CAN_NODE_ANALOG_SENSORS, RIGHT_ACCEL) \
+	X(FRONT_CAN_NODE_ANALOG_SENSORS, LEFT_ACCEL) \
+	X(FRONT_CAN_NODE_ANALOG_SENSORS, FRONT_BRAKE) \
+	X(FRONT_CAN_NODE_ANALOG_SENSORS, REAR_BRAKE) \
+	X(FRONT_CAN_NODE_ANALOG_SENSORS, STEERING) \
+	X(FRONT_CAN_NODE_WHEEL_SPEED, FRONT_RIGHT_WHEEL_SPEED) \
+	X(FRONT_CAN_NODE_WHEEL_SPEED, FRONT_LEFT_WHEEL_SPEED) \
+	X(VCU_HEARTBEAT, STATE) \
+	X(VCU_DISCHARGE_REQUEST, DISCHARGE_REQUEST)
+
+typedef enum {
+#define CAN_SIGNAL_ENUM(message, signal) CAN_SIGNAL_##message##__##signal,
+	CAN_SIGNALS(CAN_SIGNAL_ENUM)
+#undef CAN_SIGNAL_ENUM
+	CAN_SIGNAL_COUNT
+} CAN_SIGNAL_T;
+
+typedef struct {
+	uint16_t id;
+	uint8_t start;
+	uint8_t end;
+} CAN_SIGNAL_DESCRIPTOR_T;
+
+/**
+ * Where each signal sits, indexed by CAN_SIGNAL_T. All ids are 11 bit.
+ */
+extern const CAN_SIGNAL_DESCRIPTOR_T CAN_Signals[CAN_SIGNAL_COUNT];
+
+/**
+ * @details decodes one signal of a message described by CAN_Signals. The
+ * caller checks the message id.
+ *
+ * @param msg_obj message containing the signal
+ * @param signal signal to decode, at most 32 bits wide
+ * @return raw signal value
+ */
+RAMFUNC uint32_t CAN_ExtractSignal(const CCAN_MSG_OBJ_T * msg_obj, CAN_SIGNAL_T signal);
+
+/**
+ * @param signal signal described by CAN_Signals
+ * @param dlc payload length
+ * @return true if a frame of dlc bytes carries the signal
+ */
+RAMFUNC bool CAN_SignalInFrame(CAN_SIGNAL_T signal, uint8_t dlc);
+
+/**
+ * @details overwrites bits start..end of a payload, the inverse of the
+ * decoders for a frame of dlc bytes. Bits of value beyond the signal
+ * width are dropped.
+ *
+ * @param data payload, mutated in place
+ * @param dlc payload length, at most 8
+ * @param start first bit
+ * @param end last bit
+ * @param value value to place
+ * @return false, leaving data alone, if the bits don't fit in the frame
+ */
+bool CAN_InsertSignal(uint8_t * data, uint8_t dlc, uint32_t start, uint32_t end, uint64_t value);
+
+#endif
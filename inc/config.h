@@ -0,0 +1,63 @@
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetry.h"
+
+// last 4K sector of the 32K flash, kept out of the FLASH region in gcc.ld
+#define CONFIG_SECTOR 7
+#define CONFIG_ADDRESS 0x7000
+
+#define CONFIG_MAGIC 0x54534554
+// bump whenever TESTER_CONFIG_T changes layout, older records are then
+// ignored and the defaults are used instead
+#define CONFIG_VERSION 4
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t length;
+
+	uint8_t vcu_state;
+	uint8_t idle_enabled;
+	uint16_t vcu_heartbeat_period_ms;
+	uint32_t loop_budget_us;
+	uint16_t telemetry_period_ms[TELEMETRY_SIGNAL_COUNT];
+	uint32_t filter_id;
+	uint32_t filter_mask;
+	uint8_t gateway_at_boot;
+	uint8_t can_listen_only;
+	uint32_t can_bitrate;
+
+	// must stay the last member, covers every byte before it
+	uint32_t crc;
+} TESTER_CONFIG_T;
+
+/**
+ * @details reads the configuration record from flash. config is left
+ * untouched if the record is missing, from another version or corrupt, so
+ * callers fill it with defaults first.
+ *
+ * @param config datatype that is mutated to hold the loaded configuration
+ * @return true if a valid record was loaded
+ */
+bool Config_Load(TESTER_CONFIG_T * config);
+
+/**
+ * @details writes config to the reserved flash sector using IAP. Interrupts
+ * are disabled for the erase and write, roughly 100 ms.
+ *
+ * @param config configuration to store, its header and crc are filled in
+ * @return true if the record was written and reads back correctly
+ */
+bool Config_Save(TESTER_CONFIG_T * config);
+
+/**
+ * @details erases the reserved flash sector so the next boot uses the defaults
+ *
+ * @return true if the sector was erased
+ */
+bool Config_Erase(void);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef _DEBUG_H_
+#define _DEBUG_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "chip.h"
+#include "profile.h"
+#include "serial.h"
+
+#ifndef DEBUG_ENABLE
+#define DEBUG_ENABLE
+#endif
+
+#ifdef DEBUG_ENABLE
+    #define DEBUG_Print(str) do { \
+        PROFILE_Enter(PROFILE_DEBUG_PRINT); \
+        Serial_Write(str, strlen(str)); \
+        PROFILE_Exit(PROFILE_DEBUG_PRINT); \
+    } while (0)
+    #define DEBUG_Write(str, count) Serial_Write(str, count)
+#else
+    #define DEBUG_Print(str)
+    #define DEBUG_Write(str, count)
+#endif
+
+/**
+ * @details prints an unsigned number to the terminal
+ *
+ * @param value number to print
+ * @param base base to print the number in (10 or 16)
+ */
+void DEBUG_PrintNumber(uint32_t value, uint8_t base);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _DISPATCH_H_
+#define _DISPATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ccand_11xx.h"
+#include "ramfunc.h"
+
+// power of 2, kept at least twice the number of registered ids so probe
+// sequences stay short
+#define DISPATCH_TABLE_SIZE 32
+
+// bits of mode_id that identify a message: the 29 bit id and the extended flag
+#define DISPATCH_KEY_MASK (CAN_MSGOBJ_EXT | 0x1FFFFFFF)
+
+typedef void (*DISPATCH_HANDLER_T)(CCAN_MSG_OBJ_T * msg_obj);
+
+typedef struct {
+	uint32_t key;
+	DISPATCH_HANDLER_T handler;
+} DISPATCH_ENTRY_T;
+
+/**
+ * @details empties the dispatch table and clears the acceptance filter
+ */
+void Dispatch_Init(void);
+
+/**
+ * @details registers the handler for a message id. Standard ids are given
+ * as is, extended ids are or'ed with CAN_MSGOBJ_EXT.
+ *
+ * @param mode_id message id
+ * @param handler function called for every accepted message with this id
+ * @return false if the table is full
+ */
+bool Dispatch_Register(uint32_t mode_id, DISPATCH_HANDLER_T handler);
+
+/**
+ * @details finds the handler for a message id with an open addressing
+ * (linear probing) hash lookup
+ *
+ * @param mode_id message id, as received in CCAN_MSG_OBJ_T
+ * @return the registered handler, NULL if there is none
+ */
+RAMFUNC DISPATCH_HANDLER_T Dispatch_Lookup(uint32_t mode_id);
+
+/**
+ * @details sets a software acceptance filter. A message is accepted when
+ * (mode_id & mask) == (id & mask); a zero mask accepts everything.
+ *
+ * @param id id to compare against, or'ed with CAN_MSGOBJ_EXT for extended ids
+ * @param mask bits of the id to compare, include CAN_MSGOBJ_EXT to tell
+ * standard and extended frames apart
+ */
+void Dispatch_SetFilter(uint32_t id, uint32_t mask);
+
+/**
+ * @param id mutated to hold the filter id
+ * @param mask mutated to hold the filter mask
+ */
+void Dispatch_GetFilter(uint32_t * id, uint32_t * mask);
+
+/**
+ * @param mode_id message id, as received in CCAN_MSG_OBJ_T
+ * @return true if the message passes the acceptance filter
+ */
+RAMFUNC bool Dispatch_Accepts(uint32_t mode_id);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef _FAULT_H_
+#define _FAULT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Fault injection on the transmit path. Frames the tester originates (VCU
+ * heartbeats, emulated BMS messages, raw frames and test scripts) pass
+ * through Fault_Transmit, which applies the rule set for their id before
+ * handing them to the CAN transmit queue. Frames forwarded by the SLCAN
+ * gateway are never faulted.
+ *
+ * A rule fires either with a probability, drawn from a seeded PRNG so a run
+ * can be repeated, or on a fixed pattern of frames. The time from the first
+ * injected fault to the BMS reporting an error is measured.
+ */
+
+#define FAULT_RULE_COUNT 4
+// frames held back by delay and reorder rules
+#define FAULT_HELD_FRAMES 4
+// a reordered frame goes out after the next one with its id, or after this
+#define FAULT_REORDER_TIMEOUT_MS 1000
+#define FAULT_MAX_PATTERN_LENGTH 32
+#define FAULT_DEFAULT_SEED 0x2545F491UL
+
+typedef enum {
+	FAULT_NONE,
+	FAULT_DROP,		// the frame is not sent
+	FAULT_DELAY,		// the frame is sent delay_ms later
+	FAULT_DUPLICATE,	// the frame is sent twice
+	FAULT_REORDER,		// the frame is swapped with the next one with its id
+	FAULT_CORRUPT		// a signal of the frame is overwritten
+} FAULT_ACTION_T;
+
+typedef struct {
+	uint32_t mode_id;
+	uint8_t action;
+	// chance a frame is faulted in percent, used when pattern_length is 0
+	uint8_t probability;
+	// frames in the repeating pattern, bit i of pattern faults the i-th one
+	uint8_t pattern_length;
+	uint32_t pattern;
+	uint16_t delay_ms;
+	// corrupted signal bits, numbered as the can_utils decoders read them
+	// (see can_utils.h). Frames too short to hold it are sent unharmed.
+	uint8_t signal_start;
+	uint8_t signal_end;
+	uint32_t signal_value;
+} FAULT_RULE_T;
+
+/**
+ * @details clears the rules, held frames and statistics and seeds the PRNG
+ * with FAULT_DEFAULT_SEED
+ */
+void Fault_Init(void);
+
+/**
+ * @details adds a rule, replacing the one for the same id. A rule with
+ * action FAULT_NONE removes the rule for its id. Restarts the detection
+ * measurement.
+ *
+ * @param rule rule to copy
+ * @return false if the rule is invalid or all FAULT_RULE_COUNT rules are used
+ */
+bool Fault_SetRule(const FAULT_RULE_T * rule);
+
+/**
+ * @details removes all rules and sends the held frames
+ */
+void Fault_ClearRules(void);
+
+/**
+ * @details restarts the PRNG so the same rules fault the same frames again
+ *
+ * @param seed PRNG seed, 0 selects FAULT_DEFAULT_SEED
+ */
+void Fault_Seed(uint32_t seed);
+
+/**
+ * @details sends a frame through the fault rules, see CanBus_Transmit
+ *
+ * @param mode_id message id, or'ed with CAN_MSGOBJ_EXT for a 29 bit id
+ * @param data payload
+ * @param dlc payload length, at most 8
+ * @return false if the transmit queue dropped the frame. Frames dropped or
+ * held back by a rule count as sent.
+ */
+bool Fault_Transmit(uint32_t mode_id, const uint8_t * data, uint8_t dlc);
+
+/**
+ * @details sends held frames whose delay or reorder timeout has run out
+ *
+ * @return true if a frame was sent
+ */
+bool Fault_Update(void);
+
+/**
+ * @details reports that the device under test flagged an error. The first
+ * report after a fault was injected prints and records the detection time.
+ */
+void Fault_MarkDetected(void);
+
+/**
+ * @details prints the rules with their match and injection counts and the
+ * last detection time
+ */
+void Fault_Dump(void);
+
+#endif
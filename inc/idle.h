@@ -0,0 +1,55 @@
+#ifndef _IDLE_H_
+#define _IDLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+	uint32_t sleeps;
+	uint64_t sleep_cycles;
+	uint32_t dispatches;
+	uint32_t worst_wake_latency_cycles;
+	uint64_t total_wake_latency_cycles;
+} IDLE_STATS_T;
+
+/**
+ * @details clears the idle statistics
+ *
+ * @param enabled true to sleep between events, false to busy poll
+ */
+void Idle_Init(bool enabled);
+
+/**
+ * @param enabled true to sleep between events, false to busy poll
+ */
+void Idle_SetEnabled(bool enabled);
+
+/**
+ * @return true if the main loop sleeps between events
+ */
+bool Idle_IsEnabled(void);
+
+/**
+ * @details sleeps with WFI until the next CAN, UART or SysTick interrupt.
+ * Call only when the last main loop iteration found nothing to do.
+ *
+ * @return cycles spent in Idle_Sleep, 0 when sleeping is disabled
+ */
+uint32_t Idle_Sleep(void);
+
+/**
+ * @details records that an event is being dispatched. The first dispatch
+ * after a wake-up is used to measure the latency from the interrupt that
+ * delivered the event to its dispatch, which covers the wake-up.
+ *
+ * @param event_cycles Timebase_GetCycles reading taken in the interrupt
+ * that delivered the event, such as a CanBus_Receive stamp
+ */
+void Idle_MarkDispatch(uint32_t event_cycles);
+
+/**
+ * @details prints sleep count, time spent asleep and wake-up latency
+ */
+void Idle_Dump(void);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _LOOP_MONITOR_H_
+#define _LOOP_MONITOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LOOP_MONITOR_BUCKET_COUNT 12
+#define LOOP_MONITOR_DEFAULT_BUDGET_US 2000
+#define LOOP_MONITOR_REPORT_PERIOD_MS 1000
+#define LOOP_MONITOR_WATCHDOG_TIMEOUT_MS 250
+
+typedef struct {
+	uint32_t iterations;
+	uint32_t worst_us;
+	uint32_t overruns;
+	uint32_t histogram[LOOP_MONITOR_BUCKET_COUNT];
+} LOOP_MONITOR_STATS_T;
+
+/**
+ * @details resets the statistics and, when built with LOOP_WATCHDOG_ENABLE,
+ * starts the hardware watchdog
+ *
+ * @param budget_us maximum main loop iteration time before an overrun is raised
+ */
+void LoopMonitor_Init(uint32_t budget_us);
+
+/**
+ * @details marks the start of a main loop iteration. The time since the
+ * previous call, less the time slept, is added to the histogram and
+ * compared to the budget. The watchdog is only fed when the iteration
+ * stayed under budget.
+ */
+void LoopMonitor_Tick(void);
+
+/**
+ * @details leaves time spent asleep out of the current iteration, an idle
+ * loop waiting for the next event isn't a slow one
+ *
+ * @param sleep_cycles cycles slept, as returned by Idle_Sleep
+ */
+void LoopMonitor_Slept(uint32_t sleep_cycles);
+
+/**
+ * @details prints an overrun event if any iteration exceeded the budget
+ * since the last report. Reports are limited to one per
+ * LOOP_MONITOR_REPORT_PERIOD_MS so reporting cannot cause a stall itself.
+ */
+void LoopMonitor_Report(void);
+
+/**
+ * @param budget_us new iteration budget in microseconds
+ */
+void LoopMonitor_SetBudget(uint32_t budget_us);
+
+/**
+ * @return current iteration budget in microseconds
+ */
+uint32_t LoopMonitor_GetBudget(void);
+
+/**
+ * @details prints worst-case iteration time, overrun count and histogram
+ */
+void LoopMonitor_Dump(void);
+
+#endif
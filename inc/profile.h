@@ -0,0 +1,59 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <stdint.h>
+
+typedef enum {
+	PROFILE_PROCESS_CAN_INPUTS,
+	PROFILE_MAKE_BMS_HEARTBEAT,
+	PROFILE_DEBUG_PRINT,
+	PROFILE_REGION_COUNT
+} PROFILE_REGION_T;
+
+typedef struct {
+	uint32_t count;
+	uint32_t min_cycles;
+	uint32_t max_cycles;
+	uint64_t total_cycles;
+	uint32_t start_cycles;
+} PROFILE_ENTRY_T;
+
+/**
+ * Enter/exit probes. They compile to nothing unless PROFILE_ENABLE is
+ * defined, so instrumented code costs nothing in a normal build.
+ */
+#ifdef PROFILE_ENABLE
+    #define PROFILE_Enter(region) Profile_Enter(region)
+    #define PROFILE_Exit(region) Profile_Exit(region)
+#else
+    #define PROFILE_Enter(region)
+    #define PROFILE_Exit(region)
+#endif
+
+/**
+ * @details clears the profile table and measures the cost of an empty
+ * enter/exit pair, which is subtracted from every later measurement
+ */
+void Profile_Init(void);
+
+/**
+ * @details records the start of an instrumented region
+ *
+ * @param region region being entered
+ */
+void Profile_Enter(PROFILE_REGION_T region);
+
+/**
+ * @details records the end of an instrumented region and folds the elapsed
+ * cycles into its min/max/total
+ *
+ * @param region region being exited
+ */
+void Profile_Exit(PROFILE_REGION_T region);
+
+/**
+ * @details prints the profile table to the terminal
+ */
+void Profile_Dump(void);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _RAMFUNC_H_
+#define _RAMFUNC_H_
+
+/**
+ * Places a function in the .ramfunc section, which the startup code copies
+ * from flash to SRAM next to .data (see gcc.ld). Flash needs a wait state at
+ * 48 MHz, SRAM doesn't, so this is for the short per-frame paths only: every
+ * byte also costs RAM.
+ *
+ * Put it on both the declaration and the definition. long_call makes
+ * callers in flash reach the function without a linker veneer, noinline
+ * stops the body being inlined back into a flash caller.
+ *
+ * The rule the other way: code in .ramfunc calls only other RAMFUNC
+ * functions, static inline functions from headers (the CMSIS intrinsics,
+ * seqlock.h) and the ROM API through LPC_CCAN_API. No flash functions, so
+ * no memcpy and no libgcc helpers either: no division and no variable 64
+ * bit shifts. A flash call from SRAM needs a veneer and a wait state per
+ * fetch, the very thing RAMFUNC avoids.
+ *
+ * Host builds (TEST_HARDWARE) have no such section, the macro is empty.
+ */
+#ifdef TEST_HARDWARE
+    #define RAMFUNC
+#else
+    #define RAMFUNC __attribute__((section(".ramfunc"), long_call, noinline))
+#endif
+
+#endif
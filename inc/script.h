@@ -0,0 +1,105 @@
+#ifndef _SCRIPT_H_
+#define _SCRIPT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ccand_11xx.h"
+
+/**
+ * Test scripts run on the tester at bus speed. A script is a sequence of
+ * steps, each an opcode byte followed by its operands. Multi-byte operands
+ * are big endian, ids are given as mode_id (or'ed with CAN_MSGOBJ_EXT for
+ * 29 bit ids).
+ *
+ *   0x00                                      end, the script passed
+ *   0x01 id[4] dlc data[dlc]                  send a frame once
+ *   0x02 slot period_ms[2] id[4] dlc data[dlc]  send a frame every period,
+ *                                             period 0 stops the slot
+ *   0x03 id[4] timeout_ms[2] len value[len] mask[len]
+ *                                             wait for a frame with this id
+ *                                             whose first len data bytes
+ *                                             and'ed with mask equal value,
+ *                                             fail after timeout_ms
+ *   0x04 ms[2]                                wait
+ *
+ * Scripts are uploaded with Script_LoadByte as
+ *
+ *   length[2] script[length] checksum
+ *
+ * where checksum is the 8 bit sum of the script bytes. tools/script_run.py
+ * assembles a text script, uploads and runs it.
+ */
+
+#define SCRIPT_OP_END 0x00
+#define SCRIPT_OP_SEND 0x01
+#define SCRIPT_OP_PERIODIC 0x02
+#define SCRIPT_OP_EXPECT 0x03
+#define SCRIPT_OP_WAIT 0x04
+
+#define SCRIPT_MAX_SIZE 256
+#define SCRIPT_PERIODIC_SLOTS 4
+#define SCRIPT_UPLOAD_TIMEOUT_MS 1000
+
+typedef enum {
+	SCRIPT_LOAD_MORE,
+	SCRIPT_LOAD_DONE,
+	SCRIPT_LOAD_ERROR
+} SCRIPT_LOAD_T;
+
+/**
+ * @details forgets the loaded script and stops any running one
+ */
+void Script_Init(void);
+
+/**
+ * @details starts a new upload, discarding the loaded script
+ */
+void Script_BeginLoad(void);
+
+/**
+ * @details feeds the next uploaded byte. The script is checked once the
+ * checksum arrives: it must fit SCRIPT_MAX_SIZE, end with SCRIPT_OP_END and
+ * use valid slots and lengths.
+ *
+ * @param byte byte received over UART
+ * @return SCRIPT_LOAD_MORE until the upload is complete
+ */
+SCRIPT_LOAD_T Script_LoadByte(uint8_t byte);
+
+/**
+ * @details starts the loaded script from its first step
+ *
+ * @return false if no script is loaded
+ */
+bool Script_Start(void);
+
+/**
+ * @details stops the running script and its periodic frames, reporting it
+ * as failed
+ */
+void Script_Abort(void);
+
+/**
+ * @return true while a script is running
+ */
+bool Script_IsRunning(void);
+
+/**
+ * @details checks a received frame against the expect step being waited on.
+ * Called for every received frame, before the acceptance filter. A frame
+ * that arrived before the step started doesn't satisfy it.
+ *
+ * @param msg_obj received frame
+ * @param rx_cycles Timebase_GetCycles reading when the frame was received
+ */
+void Script_Receive(const CCAN_MSG_OBJ_T * msg_obj, uint32_t rx_cycles);
+
+/**
+ * @details sends the periodic frames that are due and executes steps until
+ * one has to wait, printing a line per expect step and the final result
+ *
+ * @return true if a frame was sent or a step executed
+ */
+bool Script_Update(void);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef _SEQLOCK_H_
+#define _SEQLOCK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chip.h"
+
+/**
+ * Sequence lock for state an interrupt handler writes and the main loop
+ * reads, so readers get a consistent copy of several fields without
+ * disabling interrupts. The writer bumps the sequence to odd, updates the
+ * fields and bumps it back to even; the reader copies the fields and
+ * copies again if the sequence moved meanwhile:
+ *
+ *   do {
+ *       sequence = Seqlock_ReadBegin(&lock);
+ *       snapshot = shared;
+ *   } while (Seqlock_ReadRetry(&lock, sequence));
+ *
+ * Writes never wait, so interrupt latency is unaffected however large the
+ * state grows. The rules that make that hold on a single core:
+ *  - a reader must never preempt a writer, read only from the main loop or
+ *    from an interrupt that the writing interrupt preempts. Retrying there
+ *    would spin forever.
+ *  - writers don't nest. A main loop writer keeps the writing interrupt
+ *    out for the duration, as it has to for the fields anyway.
+ *
+ * Single aligned 32 bit variables such as msTicks are read in one access
+ * on the Cortex-M0 and need no lock.
+ *
+ * The functions are inline so that RAMFUNC callers, the CAN interrupt
+ * among them, don't branch back into flash. __DMB also stops the compiler
+ * moving the field accesses across it.
+ */
+
+typedef struct {
+	volatile uint32_t sequence;
+} SEQLOCK_T;
+
+/**
+ * @details marks the start of an update of the protected fields
+ *
+ * @param lock lock of the fields
+ */
+static inline void Seqlock_WriteBegin(SEQLOCK_T * lock) {
+	lock->sequence++;
+	__DMB();
+}
+
+/**
+ * @details marks the end of an update started with Seqlock_WriteBegin
+ *
+ * @param lock lock of the fields
+ */
+static inline void Seqlock_WriteEnd(SEQLOCK_T * lock) {
+	__DMB();
+	lock->sequence++;
+}
+
+/**
+ * @param lock lock of the fields
+ * @return sequence to pass to Seqlock_ReadRetry after copying the fields
+ */
+static inline uint32_t Seqlock_ReadBegin(const SEQLOCK_T * lock) {
+	uint32_t sequence = lock->sequence;
+
+	__DMB();
+	// an odd sequence means an update is under way, make sure to retry
+	return sequence & ~1UL;
+}
+
+/**
+ * @param lock lock of the fields
+ * @param sequence value Seqlock_ReadBegin returned
+ * @return true if the fields changed while they were copied, copy them again
+ */
+static inline bool Seqlock_ReadRetry(const SEQLOCK_T * lock, uint32_t sequence) {
+	__DMB();
+	return lock->sequence != sequence;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef _SERIAL_H_
+#define _SERIAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// must be a power of 2 for the chip library ring buffer, sized for bursts of
+// frames sent by the host in gateway mode
+#define SERIAL_RX_BUFFER_SIZE 64
+// size of each half of the transmit double buffer
+#define SERIAL_TX_BUFFER_SIZE 128
+
+/**
+ * @details configures the UART pins, baud rate and frame format and enables
+ * the receive interrupt, so incoming bytes wake the core from sleep
+ *
+ * @param baudrate UART baud rate
+ */
+void Serial_Init(uint32_t baudrate);
+
+/**
+ * @details copies received bytes out of the receive ring buffer without blocking
+ *
+ * @param buf buffer to copy received bytes into
+ * @param len size of buf
+ * @return number of bytes copied
+ */
+uint32_t Serial_Read(uint8_t * buf, uint32_t len);
+
+/**
+ * @details the receive interrupt fires once the FIFO holds 8 bytes, or
+ * about 4 character times after the last byte when fewer arrived, so the
+ * stamp trails the end of a lone byte by that timeout
+ *
+ * @return Timebase_GetCycles reading taken in the receive interrupt that
+ * last found bytes in the FIFO
+ */
+uint32_t Serial_LastRxCycles(void);
+
+/**
+ * @return true if received bytes are waiting to be read
+ */
+bool Serial_RxPending(void);
+
+/**
+ * @details queues bytes for interrupt driven transmission. Only blocks when
+ * both halves of the transmit double buffer are full.
+ *
+ * @param data bytes to send
+ * @param len number of bytes to send
+ */
+void Serial_Write(const void * data, uint32_t len);
+
+/**
+ * @return number of bytes Serial_Write can accept without blocking
+ */
+uint32_t Serial_TxSpace(void);
+
+/**
+ * @return number of times Serial_Write had to wait for the UART
+ */
+uint32_t Serial_TxStalls(void);
+
+/**
+ * @details blocks until every queued byte has left the UART shift register
+ */
+void Serial_Flush(void);
+
+/**
+ * @details flushes pending output and switches to a new baud rate
+ *
+ * @param baudrate requested baud rate
+ * @return baud rate actually achieved by the fractional divider
+ */
+uint32_t Serial_SetBaud(uint32_t baudrate);
+
+/**
+ * @return baud rate currently in use
+ */
+uint32_t Serial_GetBaud(void);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _SIGNAL_DB_H_
+#define _SIGNAL_DB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ccand_11xx.h"
+#include "can_utils.h"
+#include "ramfunc.h"
+
+/**
+ * Latest decoded value of every signal in can_utils.h's CAN_SIGNALS, with
+ * the time it was received, so the host can poll the signals it needs
+ * (see the query command in slcan.h) instead of parsing printed text.
+ */
+
+/**
+ * @details marks every signal as never received
+ */
+void SignalDb_Init(void);
+
+/**
+ * @details decodes the signals of a received frame into the table. Frames
+ * without known signals, extended and remote frames are ignored, and so
+ * are signals that end past the frame's dlc (see can_utils.h for how
+ * bits are numbered in a short frame). May be called from the CAN receive
+ * interrupt (see seqlock.h), but from only one context at a time.
+ *
+ * @param msg_obj received frame
+ * @param received_ms msTicks when the frame was received, such as
+ * Timebase_MillisAt of its CanBus_Receive stamp
+ */
+RAMFUNC void SignalDb_Update(const CCAN_MSG_OBJ_T * msg_obj, uint32_t received_ms);
+
+/**
+ * @details looks up a signal in constant time. The value and time always
+ * come from the same frame. Not callable from an interrupt that preempts
+ * SignalDb_Update.
+ *
+ * @param signal signal to read
+ * @param value mutated to hold the latest raw value, 0 if never received
+ * @param updated_ms mutated to hold msTicks when the value arrived
+ * @return false if the signal has not been received since SignalDb_Init
+ */
+bool SignalDb_Get(CAN_SIGNAL_T signal, uint32_t * value, uint32_t * updated_ms);
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef _SLCAN_H_
+#define _SLCAN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ccand_11xx.h"
+
+/**
+ * Lawicel/slcan compatible gateway, so slcand can expose the tester as a
+ * SocketCAN interface:
+ *
+ *   slcand -o -c -s6 /dev/ttyUSB0 can0
+ *
+ * Supported commands, each terminated by CR, answered with CR on success
+ * and BEL on error:
+ *   Sn            bit rate, n = 0..8 for 10k 20k 50k 100k 125k 250k 500k 800k 1M
+ *   O / L / C     open, open listen only (never ACKs, see
+ *                 CanBus_Configure), close the channel
+ *   tiiildd..     standard frame, answered with z
+ *   Tiiiiiiiildd. extended frame, answered with Z
+ *   riiil / Riiiiiiiil  remote frames
+ *   Zn            timestamps off (0), ms modulo 60000 (1) or the low
+ *                 32 bits of the microsecond clock (2), taken in the
+ *                 CAN interrupt when the frame arrived
+ *   V / N / F     version, serial number, status flags
+ *   M / m         acceptance code and mask, accepted and ignored
+ *   b             switch to the binary protocol
+ *
+ * ESC leaves the gateway and returns to the command line interface.
+ *
+ * The binary protocol carries the same frames in fewer bytes, needed to
+ * keep up with a fully loaded 500 kbit/s bus over a 921600 baud UART.
+ * Every frame, in either direction, is
+ *
+ *   0xAA, flags, id, data, [timestamp]
+ *
+ * flags holds the dlc in bits 0-3, RTR in bit 6 and EXT in bit 7. The id is
+ * 2 bytes (standard) or 4 bytes (extended), big endian. Received frames
+ * carry a big endian timestamp when timestamps are on, 2 bytes with Z1 and
+ * 4 with Z2. A single 0xA5 byte returns to the ASCII protocol.
+ *
+ * For aligning captures with the host clock the binary protocol also has
+ *
+ *   0xAC                  ping, from the host
+ *   0xAD, rx[8], tx[8]    pong: when the ping arrived and when the pong
+ *                         was queued, in microseconds since boot
+ *   0xAB, now[8]          sync record, sent every second with Z2
+ *
+ * tools/slcan_capture.py uses them to convert frame timestamps to host time.
+ *
+ * Dashboards read the latest signal values (see signal_db.h) with
+ *
+ *   0xAE, count, signal[count]   query, from the host, signals numbered
+ *                         as CAN_SIGNAL_T in can_utils.h
+ *   0xAE, now[4], count, {signal, value[4], time[4]}[count]
+ *                         answer: msTicks now and when each value was
+ *                         received, bit 7 of signal set if it never was
+ *
+ * The table is updated whether or not the channel is open. A query for an
+ * unknown signal is answered with BEL. tools/signal_query.py polls signals
+ * by name.
+ */
+
+#define SLCAN_BINARY_FRAME 0xAA
+#define SLCAN_BINARY_EXIT 0xA5
+#define SLCAN_BINARY_SYNC 0xAB
+#define SLCAN_BINARY_PING 0xAC
+#define SLCAN_BINARY_PONG 0xAD
+#define SLCAN_BINARY_QUERY 0xAE
+#define SLCAN_EXIT_KEY 0x1B
+
+// frames read from the CAN library per call, encoded into a single UART write
+#define SLCAN_RX_BATCH 8
+// longest ASCII frame: T, 8 id digits, dlc, 16 data digits, 8 timestamp digits, CR
+#define SLCAN_MAX_ENCODED 35
+
+/**
+ * @details resets the gateway to a closed channel at 500 kbit/s using the
+ * ASCII protocol. Slcan_SetActive starts it at the tester's bit rate
+ * instead.
+ */
+void Slcan_Init(void);
+
+/**
+ * @details starts or stops the gateway. While active the main loop hands
+ * the UART and all received CAN frames to Slcan_Process. Stopping restores
+ * the bit rate and listen-only mode the gateway started with.
+ *
+ * @param enable true to start the gateway
+ */
+void Slcan_SetActive(bool enable);
+
+/**
+ * @return true if the gateway is active
+ */
+bool Slcan_IsActive(void);
+
+/**
+ * @details forwards received CAN frames to the host in batches and executes
+ * the commands and frames sent by the host
+ *
+ * @return true if any frame or byte was handled
+ */
+bool Slcan_Process(void);
+
+#endif
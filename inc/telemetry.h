@@ -0,0 +1,65 @@
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+	TELEMETRY_FRONT_RIGHT_WHEEL_SPEED,
+	TELEMETRY_FRONT_LEFT_WHEEL_SPEED,
+	TELEMETRY_RIGHT_ACCEL,
+	TELEMETRY_LEFT_ACCEL,
+	TELEMETRY_FRONT_BRAKE,
+	TELEMETRY_REAR_BRAKE,
+	TELEMETRY_STEERING,
+	TELEMETRY_PACK_VOLTAGE,
+	TELEMETRY_PACK_CURRENT,
+	TELEMETRY_AVE_CELL_VOLTAGE,
+	TELEMETRY_MIN_CELL_VOLTAGE,
+	TELEMETRY_MAX_CELL_VOLTAGE,
+	TELEMETRY_SIGNAL_COUNT
+} TELEMETRY_SIGNAL_T;
+
+// 5 Hz summaries for the fast front node signals, 2 Hz for the pack
+#define TELEMETRY_DEFAULT_FRONT_NODE_PERIOD_MS 200
+#define TELEMETRY_DEFAULT_PACK_PERIOD_MS 500
+
+/**
+ * @details sets every signal to its default output period and clears all windows
+ */
+void Telemetry_Init(void);
+
+/**
+ * @details folds a decoded value into the signal's current window. Runs in
+ * constant time and memory regardless of the input rate.
+ *
+ * @param signal signal the value belongs to
+ * @param value decoded value
+ */
+void Telemetry_Sample(TELEMETRY_SIGNAL_T signal, uint32_t value);
+
+/**
+ * @details prints the min/max/mean summary of at most one signal whose
+ * output period has elapsed, so summaries are spread over loop iterations
+ * instead of bursting on the UART
+ */
+void Telemetry_Update(void);
+
+/**
+ * @param signal signal to configure
+ * @param period_ms time between summaries, 0 to stop printing the signal
+ */
+void Telemetry_SetPeriod(TELEMETRY_SIGNAL_T signal, uint16_t period_ms);
+
+/**
+ * @param signal signal to query
+ * @return time between summaries, 0 if the signal is not printed
+ */
+uint16_t Telemetry_GetPeriod(TELEMETRY_SIGNAL_T signal);
+
+/**
+ * @details prints the index, name and output period of every signal
+ */
+void Telemetry_PrintSignals(void);
+
+#endif
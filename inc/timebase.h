@@ -0,0 +1,55 @@
+#ifndef _TIMEBASE_H_
+#define _TIMEBASE_H_
+
+#include <stdint.h>
+#include "ramfunc.h"
+
+/**
+ * Millisecond tick counter, incremented by SysTick_Handler.
+ */
+extern volatile uint32_t msTicks;
+
+/**
+ * @details returns a free-running cycle count built from msTicks and the
+ * SysTick current-value register. The count wraps roughly every 89 seconds
+ * at 48 MHz, so only differences between two readings are meaningful.
+ *
+ * @return core clock cycles since boot, modulo 2^32
+ */
+RAMFUNC uint32_t Timebase_GetCycles(void);
+
+/**
+ * @details converts a cycle count into microseconds
+ *
+ * @param cycles number of core clock cycles
+ * @return cycles expressed in microseconds
+ */
+uint32_t Timebase_CyclesToMicros(uint32_t cycles);
+
+/**
+ * @details returns a microsecond clock that doesn't wrap in practice, for
+ * timestamps the host aligns with its own clock
+ *
+ * @return microseconds since boot
+ */
+uint64_t Timebase_GetMicros(void);
+
+/**
+ * @details converts an earlier Timebase_GetCycles reading, such as one
+ * taken in an interrupt handler, to the Timebase_GetMicros clock
+ *
+ * @param cycles reading taken less than 89 seconds ago
+ * @return microseconds since boot at the time of the reading
+ */
+uint64_t Timebase_MicrosAt(uint32_t cycles);
+
+/**
+ * @details converts an earlier Timebase_GetCycles reading to the msTicks
+ * clock
+ *
+ * @param cycles reading taken less than 89 seconds ago
+ * @return msTicks at the time of the reading
+ */
+uint32_t Timebase_MillisAt(uint32_t cycles);
+
+#endif
@@ -0,0 +1,86 @@
+#include "arena.h"
+#include "chip.h"
+#include "debug.h"
+
+// from gcc.ld
+extern uint32_t __HeapLimit;
+extern uint32_t __StackLimit;
+extern uint32_t __StackTop;
+
+ARENA_T arena;
+
+#define ARENA_SIZE(id, field, type, count, name) sizeof(arena.field),
+static const uint16_t client_sizes[ARENA_CLIENT_COUNT] = {
+	ARENA_CLIENTS(ARENA_SIZE)
+};
+#undef ARENA_SIZE
+
+#define ARENA_NAME(id, field, type, count, name) name,
+static const char * const client_names[ARENA_CLIENT_COUNT] = {
+	ARENA_CLIENTS(ARENA_NAME)
+};
+#undef ARENA_NAME
+
+static volatile uint16_t high_water[ARENA_CLIENT_COUNT];
+
+/**
+ * @return bytes between the top of the stack and the deepest word that no
+ * longer holds the paint
+ */
+static uint32_t stack_high_water(void) {
+	const uint32_t * word = &__HeapLimit;
+
+	while (word < &__StackTop && *word == ARENA_STACK_PAINT) {
+		word++;
+	}
+	return (&__StackTop - word) * sizeof(uint32_t);
+}
+
+void Arena_Init(void) {
+	uint32_t * word = &__HeapLimit;
+	uint32_t * const stack_pointer = (uint32_t *) __get_MSP();
+	uint8_t i;
+
+	for (i = 0; i < ARENA_CLIENT_COUNT; i++) {
+		high_water[i] = 0;
+	}
+	while (word < stack_pointer) {
+		*word++ = ARENA_STACK_PAINT;
+	}
+}
+
+void Arena_Mark(ARENA_CLIENT_T client, uint32_t used_bytes) {
+	if (used_bytes > high_water[client]) {
+		high_water[client] = used_bytes;
+	}
+}
+
+void Arena_Dump(void) {
+	const uint32_t stack_reserved = (&__StackTop - &__StackLimit) * sizeof(uint32_t);
+	const uint32_t stack_free = (&__StackTop - &__HeapLimit) * sizeof(uint32_t);
+	uint32_t stack_peak = stack_high_water();
+	uint8_t i;
+
+	for (i = 0; i < ARENA_CLIENT_COUNT; i++) {
+		DEBUG_Print(client_names[i]);
+		DEBUG_Print(": ");
+		DEBUG_PrintNumber(high_water[i], 10);
+		DEBUG_Print(" of ");
+		DEBUG_PrintNumber(client_sizes[i], 10);
+		DEBUG_Print(" bytes\r\n");
+	}
+	DEBUG_Print("Arena: ");
+	DEBUG_PrintNumber(sizeof(ARENA_T), 10);
+	DEBUG_Print(" of ");
+	DEBUG_PrintNumber(ARENA_BUDGET_BYTES, 10);
+	DEBUG_Print(" bytes budgeted\r\nStack: ");
+	DEBUG_PrintNumber(stack_peak, 10);
+	DEBUG_Print(" bytes peak, ");
+	DEBUG_PrintNumber(stack_reserved, 10);
+	DEBUG_Print(" reserved, ");
+	DEBUG_PrintNumber(stack_free, 10);
+	DEBUG_Print(" available above the heap\r\n");
+	if (stack_peak > stack_reserved) {
+		DEBUG_Print("Stack grew past its reservation\r\n");
+	}
+}
@@ -0,0 +1,264 @@
+#include "bms_emulator.h"
+#include "can_constants.h"
+#include "can_utils.h"
+#include "fault.h"
+#include "timebase.h"
+#include "debug.h"
+
+#define BMS_EMULATOR_PERIOD_MS(freq) ((freq) > 0 ? 1000 / (freq) : BMS_EMULATOR_FALLBACK_PERIOD_MS)
+
+// cells reported as the extremes, fixed since the trajectories only script values
+#define BMS_EMULATOR_MIN_CELL_ID 3
+#define BMS_EMULATOR_MAX_CELL_ID 17
+
+typedef enum {
+	BMS_EMULATOR_HEARTBEAT,
+	BMS_EMULATOR_PACK_STATUS,
+	BMS_EMULATOR_CELL_TEMPS,
+	BMS_EMULATOR_MESSAGE_COUNT
+} BMS_EMULATOR_MESSAGE_T;
+
+typedef struct {
+	uint32_t responses;
+	uint32_t min_latency_us;
+	uint32_t max_latency_us;
+	uint64_t total_latency_us;
+} BMS_EMULATOR_STATS_T;
+
+static const uint16_t message_periods_ms[BMS_EMULATOR_MESSAGE_COUNT] = {
+	BMS_EMULATOR_PERIOD_MS(BMS_HEARTBEAT__freq),
+	BMS_EMULATOR_PERIOD_MS(BMS_PACK_STATUS__freq),
+	BMS_EMULATOR_PERIOD_MS(BMS_CELL_TEMPS__freq)
+};
+
+// a slow discharge with load steps, in raw signal units
+static const BMS_EMULATOR_TRAJECTORY_T default_trajectories[BMS_EMULATOR_SIGNAL_COUNT] = {
+	{BMS_EMULATOR_RAMP, 1000, 0, 600000},
+	{BMS_EMULATOR_TRIANGLE, 700, 900, 20000},
+	{BMS_EMULATOR_SQUARE, 50, 400, 4000},
+	{BMS_EMULATOR_TRIANGLE, 360, 400, 20000},
+	{BMS_EMULATOR_TRIANGLE, 350, 390, 20000},
+	{BMS_EMULATOR_TRIANGLE, 370, 410, 20000},
+	{BMS_EMULATOR_TRIANGLE, 25, 45, 60000},
+	{BMS_EMULATOR_TRIANGLE, 20, 40, 60000},
+	{BMS_EMULATOR_TRIANGLE, 30, 55, 60000}
+};
+
+static BMS_EMULATOR_TRAJECTORY_T trajectories[BMS_EMULATOR_SIGNAL_COUNT];
+static uint32_t last_sent[BMS_EMULATOR_MESSAGE_COUNT];
+static uint8_t next_message;
+
+static bool active;
+static uint8_t bms_state;
+static uint32_t start_time;
+
+static uint16_t response_latency_ms;
+static bool response_pending;
+static uint32_t request_time;
+static uint32_t request_cycles;
+
+static BMS_EMULATOR_STATS_T stats;
+
+/**
+ * @details evaluates a trajectory elapsed_ms after the emulator started
+ */
+static uint16_t trajectory_value(const BMS_EMULATOR_TRAJECTORY_T * trajectory, uint32_t elapsed_ms) {
+	const int64_t span = (int64_t) trajectory->to - trajectory->from;
+	uint32_t period = trajectory->period_ms;
+	uint32_t half = period / 2;
+	uint32_t phase;
+
+	if (trajectory->shape == BMS_EMULATOR_CONSTANT || period < 2) {
+		return trajectory->from;
+	}
+
+	phase = elapsed_ms % period;
+	switch (trajectory->shape) {
+		case BMS_EMULATOR_RAMP:
+			return trajectory->from + span * phase / period;
+		case BMS_EMULATOR_TRIANGLE:
+			if (phase < half) {
+				return trajectory->from + span * phase / half;
+			}
+			return trajectory->to - span * (phase - half) / (period - half);
+		case BMS_EMULATOR_SQUARE:
+			return phase < half ? trajectory->from : trajectory->to;
+		default:
+			return trajectory->from;
+	}
+}
+
+static uint16_t signal_value(BMS_EMULATOR_SIGNAL_T signal) {
+	return trajectory_value(&trajectories[signal], msTicks - start_time);
+}
+
+static void send_message(BMS_EMULATOR_MESSAGE_T message) {
+	CCAN_MSG_OBJ_T msg_obj;
+	BMS_HEARTBEAT_T heartbeat;
+	BMS_PACK_STATUS_T pack_status;
+	BMS_CELL_TEMPS_T cell_temps;
+
+	switch (message) {
+		case BMS_EMULATOR_HEARTBEAT:
+			heartbeat.state = bms_state;
+			heartbeat.soc_percentage = signal_value(BMS_EMULATOR_SOC);
+			CAN_EncodeBMSHeartbeat(&msg_obj, &heartbeat);
+			break;
+		case BMS_EMULATOR_PACK_STATUS:
+			pack_status.pack_voltage = signal_value(BMS_EMULATOR_PACK_VOLTAGE);
+			pack_status.pack_current = signal_value(BMS_EMULATOR_PACK_CURRENT);
+			pack_status.ave_cell_voltage = signal_value(BMS_EMULATOR_AVE_CELL_VOLTAGE);
+			pack_status.min_cell_voltage = signal_value(BMS_EMULATOR_MIN_CELL_VOLTAGE);
+			pack_status.min_cell_voltage_id = BMS_EMULATOR_MIN_CELL_ID;
+			pack_status.max_cell_voltage = signal_value(BMS_EMULATOR_MAX_CELL_VOLTAGE);
+			pack_status.max_cell_voltage_id = BMS_EMULATOR_MAX_CELL_ID;
+			CAN_EncodeBMSPackStatus(&msg_obj, &pack_status);
+			break;
+		case BMS_EMULATOR_CELL_TEMPS:
+			cell_temps.ave_cell_temp = signal_value(BMS_EMULATOR_AVE_CELL_TEMP);
+			cell_temps.min_cell_temp = signal_value(BMS_EMULATOR_MIN_CELL_TEMP);
+			cell_temps.min_cell_temp_id = BMS_EMULATOR_MIN_CELL_ID;
+			cell_temps.max_cell_temp = signal_value(BMS_EMULATOR_MAX_CELL_TEMP);
+			cell_temps.max_cell_temp_id = BMS_EMULATOR_MAX_CELL_ID;
+			CAN_EncodeBMSCellTemps(&msg_obj, &cell_temps);
+			break;
+		default:
+			return;
+	}
+	Fault_Transmit(msg_obj.mode_id, msg_obj.data, msg_obj.dlc);
+}
+
+static void send_discharge_response(void) {
+	CCAN_MSG_OBJ_T msg_obj;
+	BMS_DISCHARGE_RESPONSE_T response;
+	uint32_t latency_us;
+
+	response.discharge_response = ____BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__READY;
+	CAN_EncodeBMSDischargeResponse(&msg_obj, &response);
+	Fault_Transmit(msg_obj.mode_id, msg_obj.data, msg_obj.dlc);
+	latency_us = Timebase_CyclesToMicros(Timebase_GetCycles() - request_cycles);
+
+	response_pending = false;
+	bms_state = ____BMS_HEARTBEAT__STATE__DISCHARGE;
+
+	stats.responses++;
+	stats.total_latency_us += latency_us;
+	if (latency_us < stats.min_latency_us) {
+		stats.min_latency_us = latency_us;
+	}
+	if (latency_us > stats.max_latency_us) {
+		stats.max_latency_us = latency_us;
+	}
+}
+
+void BmsEmulator_Init(void) {
+	uint8_t i;
+
+	active = false;
+	response_pending = false;
+	response_latency_ms = BMS_EMULATOR_DEFAULT_RESPONSE_LATENCY_MS;
+	for (i = 0; i < BMS_EMULATOR_SIGNAL_COUNT; i++) {
+		trajectories[i] = default_trajectories[i];
+	}
+	stats.responses = 0;
+	stats.min_latency_us = UINT32_MAX;
+	stats.max_latency_us = 0;
+	stats.total_latency_us = 0;
+}
+
+void BmsEmulator_SetActive(bool enable) {
+	uint8_t i;
+
+	if (enable && !active) {
+		start_time = msTicks;
+		bms_state = ____BMS_HEARTBEAT__STATE__STANDBY;
+		response_pending = false;
+		next_message = 0;
+		for (i = 0; i < BMS_EMULATOR_MESSAGE_COUNT; i++) {
+			// send everything on the first update
+			last_sent[i] = start_time - message_periods_ms[i];
+		}
+	}
+	active = enable;
+}
+
+bool BmsEmulator_IsActive(void) {
+	return active;
+}
+
+void BmsEmulator_SetTrajectory(BMS_EMULATOR_SIGNAL_T signal, const BMS_EMULATOR_TRAJECTORY_T * trajectory) {
+	trajectories[signal] = *trajectory;
+}
+
+void BmsEmulator_SetResponseLatency(uint16_t latency_ms) {
+	response_latency_ms = latency_ms;
+}
+
+uint16_t BmsEmulator_GetResponseLatency(void) {
+	return response_latency_ms;
+}
+
+void BmsEmulator_DischargeRequested(uint32_t rx_cycles) {
+	if (!active || response_pending) {
+		return;
+	}
+	response_pending = true;
+	request_time = Timebase_MillisAt(rx_cycles);
+	request_cycles = rx_cycles;
+}
+
+bool BmsEmulator_Update(void) {
+	uint8_t checked;
+
+	if (!active) {
+		return false;
+	}
+
+	if (response_pending && msTicks - request_time >= response_latency_ms) {
+		send_discharge_response();
+		return true;
+	}
+
+	// round robin so messages falling due together go out on consecutive loops
+	for (checked = 0; checked < BMS_EMULATOR_MESSAGE_COUNT; checked++) {
+		uint8_t message = next_message;
+
+		next_message = (next_message + 1) % BMS_EMULATOR_MESSAGE_COUNT;
+		if (msTicks - last_sent[message] >= message_periods_ms[message]) {
+			last_sent[message] += message_periods_ms[message];
+			// don't try to catch up after a stall, just resume the period
+			if (msTicks - last_sent[message] >= message_periods_ms[message]) {
+				last_sent[message] = msTicks;
+			}
+			send_message(message);
+			return true;
+		}
+	}
+	return false;
+}
+
+void BmsEmulator_Dump(void) {
+	BMS_EMULATOR_STATS_T snapshot = stats;
+
+	DEBUG_Print("BMS emulator: ");
+	DEBUG_Print(active ? "on" : "off");
+	DEBUG_Print(", state ");
+	DEBUG_PrintNumber(bms_state, 10);
+	DEBUG_Print(", SOC ");
+	DEBUG_PrintNumber(signal_value(BMS_EMULATOR_SOC), 10);
+	DEBUG_Print("\r\nDischarge responses: ");
+	DEBUG_PrintNumber(snapshot.responses, 10);
+	DEBUG_Print(", target ");
+	DEBUG_PrintNumber(response_latency_ms, 10);
+	DEBUG_Print(" ms");
+	if (snapshot.responses != 0) {
+		DEBUG_Print(", min ");
+		DEBUG_PrintNumber(snapshot.min_latency_us, 10);
+		DEBUG_Print(" us, max ");
+		DEBUG_PrintNumber(snapshot.max_latency_us, 10);
+		DEBUG_Print(" us, avg ");
+		DEBUG_PrintNumber(snapshot.total_latency_us / snapshot.responses, 10);
+		DEBUG_Print(" us");
+	}
+	DEBUG_Print("\r\n");
+}
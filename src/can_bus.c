@@ -0,0 +1,466 @@
+#include <string.h>
+#include "can_bus.h"
+#include "can.h"
+#include "chip.h"
+#include "arena.h"
+#include "timebase.h"
+#include "seqlock.h"
+#include "debug.h"
+
+// the queue lives in the arena (see arena.h), sorted with the lowest
+// priority frame first so the next one to send comes off the end
+#define tx_queue (arena.can_tx_queue)
+
+// C_CAN registers for silent mode and bit rate detection
+#define CAN_BUS_CNTL_INIT (1 << 0)
+#define CAN_BUS_CNTL_TEST (1 << 7)
+#define CAN_BUS_TEST_SILENT (1 << 3)
+#define CAN_BUS_STAT_LEC_MASK 0x7
+#define CAN_BUS_STAT_LEC_NONE 0
+// never set by the controller, written to see whether the last error code changed
+#define CAN_BUS_STAT_LEC_UNUSED 7
+
+typedef struct {
+	bool busy;
+	uint32_t queued_cycles;
+} CAN_BUS_TX_SLOT_T;
+
+static uint8_t tx_depth;
+static CAN_BUS_TX_SLOT_T tx_slots[CAN_BUS_TX_MSGOBJ_COUNT];
+static CAN_BUS_TX_STATS_T tx_stats;
+// guards tx_stats and tx_depth for CanBus_Dump, written from the CAN
+// interrupt and SysTick too
+static SEQLOCK_T tx_stats_lock;
+
+// when each frame in the CAN library's receive buffer arrived, oldest at
+// the tail; the head belongs to the CAN interrupt, the tail to the main loop
+static volatile uint32_t rx_stamps[CAN_BUS_RX_STAMP_COUNT];
+static volatile uint8_t rx_stamp_head;
+static volatile uint8_t rx_stamp_tail;
+
+static uint32_t current_bitrate;
+static bool listen_only;
+
+static const uint32_t bitrates[CAN_BUS_BITRATE_COUNT] = CAN_BUS_BITRATES;
+
+static bool autobaud_running;
+static uint8_t autobaud_index;
+static uint8_t autobaud_round;
+static uint8_t autobaud_frames;
+static uint32_t autobaud_start_time;
+static uint32_t autobaud_previous_bitrate;
+static bool autobaud_previous_listen_only;
+
+/**
+ * @details orders frames the way bus arbitration does: the 11 bit base id,
+ * then RTR of a standard frame against SRR of an extended one, IDE, the
+ * 18 bit id extension and the RTR of an extended frame. Lower wins.
+ */
+static uint32_t arbitration_key(uint32_t mode_id) {
+	uint32_t remote = (mode_id & CAN_MSGOBJ_RTR) ? 1 : 0;
+	uint32_t id;
+
+	if (mode_id & CAN_MSGOBJ_EXT) {
+		id = mode_id & CAN_BUS_MAX_EXT_ID;
+		return ((id >> 18) << 21) | (1UL << 20) | (1UL << 19) | ((id & 0x3FFFF) << 1) | remote;
+	}
+	return ((mode_id & CAN_BUS_MAX_STD_ID) << 21) | (remote << 20);
+}
+
+RAMFUNC static bool msgobj_pending(uint8_t msgobj) {
+	uint32_t txreq = msgobj < 16 ? LPC_CCAN->TXREQ1 : LPC_CCAN->TXREQ2;
+
+	return (txreq >> (msgobj & 0xF)) & 1;
+}
+
+/**
+ * @return false if the queue is full of frames with at least the priority
+ * of this one
+ */
+static bool queue_insert(const CAN_BUS_TX_ENTRY_T * frame) {
+	uint32_t key = arbitration_key(frame->mode_id);
+	uint8_t pos = 0;
+
+	if (tx_depth == CAN_BUS_TX_QUEUE_SIZE) {
+		if (arbitration_key(tx_queue[0].mode_id) <= key) {
+			return false;
+		}
+		memmove(&tx_queue[0], &tx_queue[1], (tx_depth - 1) * sizeof(CAN_BUS_TX_ENTRY_T));
+		tx_depth--;
+		tx_stats.dropped++;
+	}
+
+	// frames with the same key stay in the order they were queued
+	while (pos < tx_depth && arbitration_key(tx_queue[pos].mode_id) > key) {
+		pos++;
+	}
+	memmove(&tx_queue[pos + 1], &tx_queue[pos], (tx_depth - pos) * sizeof(CAN_BUS_TX_ENTRY_T));
+	tx_queue[pos] = *frame;
+	tx_depth++;
+
+	if (tx_depth > tx_stats.max_depth) {
+		tx_stats.max_depth = tx_depth;
+		Arena_Mark(ARENA_CAN_TX_QUEUE, tx_depth * sizeof(CAN_BUS_TX_ENTRY_T));
+	}
+	return true;
+}
+
+/**
+ * @details copies the payload by hand, memcpy lives in flash
+ */
+RAMFUNC static void load_msgobj(uint8_t msgobj, const CAN_BUS_TX_ENTRY_T * frame) {
+	CCAN_MSG_OBJ_T msg_obj;
+	uint8_t i;
+
+	msg_obj.msgobj = msgobj;
+	msg_obj.mode_id = frame->mode_id;
+	msg_obj.mask = 0;
+	msg_obj.dlc = frame->dlc;
+	for (i = 0; i < frame->dlc; i++) {
+		msg_obj.data[i] = frame->data[i];
+	}
+	LPC_CCAN_API->can_transmit(&msg_obj);
+}
+
+RAMFUNC static void record_sent(uint32_t now, uint32_t queued_cycles) {
+	uint32_t latency_cycles = now - queued_cycles;
+
+	tx_stats.sent++;
+	tx_stats.total_latency_cycles += latency_cycles;
+	if (latency_cycles < tx_stats.min_latency_cycles) {
+		tx_stats.min_latency_cycles = latency_cycles;
+	}
+	if (latency_cycles > tx_stats.max_latency_cycles) {
+		tx_stats.max_latency_cycles = latency_cycles;
+	}
+}
+
+/**
+ * @details CanBus_Poll without the locking, for callers that already keep
+ * the CAN interrupt and SysTick out
+ *
+ * @param now Timebase_GetCycles reading to count frames found sent as sent at
+ */
+RAMFUNC static void poll(uint32_t now) {
+	uint8_t i;
+
+	for (i = 0; i < CAN_BUS_TX_MSGOBJ_COUNT; i++) {
+		CAN_BUS_TX_SLOT_T * slot = &tx_slots[i];
+		uint8_t msgobj = CAN_BUS_TX_MSGOBJ_FIRST + i;
+
+		if (slot->busy && !msgobj_pending(msgobj)) {
+			slot->busy = false;
+			record_sent(now, slot->queued_cycles);
+		}
+		if (!slot->busy && tx_depth > 0) {
+			const CAN_BUS_TX_ENTRY_T * frame = &tx_queue[--tx_depth];
+			load_msgobj(msgobj, frame);
+			slot->busy = true;
+			slot->queued_cycles = frame->queued_cycles;
+		}
+	}
+}
+
+/**
+ * @details enters or leaves silent mode, with the controller held in init
+ * so no frame is cut in half
+ */
+static void set_silent(bool silent) {
+	LPC_CCAN->CNTL |= CAN_BUS_CNTL_INIT;
+	if (silent) {
+		LPC_CCAN->CNTL |= CAN_BUS_CNTL_TEST;
+		LPC_CCAN->TEST = CAN_BUS_TEST_SILENT;
+	} else {
+		LPC_CCAN->TEST = 0;
+		LPC_CCAN->CNTL &= ~CAN_BUS_CNTL_TEST;
+	}
+	LPC_CCAN->CNTL &= ~CAN_BUS_CNTL_INIT;
+}
+
+static void init_peripheral(void) {
+	CCAN_MSG_OBJ_T msg_obj;
+
+	// CAN_Init empties the library's receive buffer, the stamps have to go
+	// with it before another frame comes in
+	__disable_irq();
+	CAN_Init(current_bitrate);
+	rx_stamp_head = 0;
+	rx_stamp_tail = 0;
+	__enable_irq();
+
+	// dedicated receive object for 29 bit ids, a zero mask accepts all of them
+	msg_obj.msgobj = CAN_BUS_EXT_RX_MSGOBJ;
+	msg_obj.mode_id = CAN_MSGOBJ_EXT;
+	msg_obj.mask = 0;
+	LPC_CCAN_API->config_rxmsgobj(&msg_obj);
+
+	if (listen_only) {
+		set_silent(true);
+	}
+}
+
+/**
+ * @details forgets the queued frames and those still in message objects,
+ * counting them as dropped
+ */
+static void drop_pending(void) {
+	uint8_t i;
+
+	__disable_irq();
+	Seqlock_WriteBegin(&tx_stats_lock);
+	tx_stats.dropped += tx_depth;
+	tx_depth = 0;
+	for (i = 0; i < CAN_BUS_TX_MSGOBJ_COUNT; i++) {
+		if (tx_slots[i].busy) {
+			tx_stats.dropped++;
+			tx_slots[i].busy = false;
+		}
+	}
+	Seqlock_WriteEnd(&tx_stats_lock);
+	__enable_irq();
+}
+
+void CanBus_Init(uint32_t bitrate, bool listen_only_mode) {
+	uint8_t i;
+
+	__disable_irq();
+	Seqlock_WriteBegin(&tx_stats_lock);
+	tx_depth = 0;
+	for (i = 0; i < CAN_BUS_TX_MSGOBJ_COUNT; i++) {
+		tx_slots[i].busy = false;
+	}
+	memset(&tx_stats, 0, sizeof(tx_stats));
+	tx_stats.min_latency_cycles = UINT32_MAX;
+	Seqlock_WriteEnd(&tx_stats_lock);
+	__enable_irq();
+
+	current_bitrate = bitrate;
+	listen_only = listen_only_mode;
+	autobaud_running = false;
+	init_peripheral();
+}
+
+void CanBus_Reset(void) {
+	drop_pending();
+	CAN_ResetPeripheral();
+	init_peripheral();
+}
+
+void CanBus_Configure(uint32_t bitrate, bool listen_only_mode) {
+	if (bitrate != current_bitrate) {
+		current_bitrate = bitrate;
+		listen_only = listen_only_mode;
+		CanBus_Reset();
+	} else if (listen_only_mode != listen_only) {
+		if (listen_only_mode) {
+			drop_pending();
+		}
+		listen_only = listen_only_mode;
+		set_silent(listen_only);
+	}
+}
+
+uint32_t CanBus_GetBitrate(void) {
+	return current_bitrate;
+}
+
+bool CanBus_IsListenOnly(void) {
+	return listen_only;
+}
+
+bool CanBus_IsStandardBitrate(uint32_t bitrate) {
+	uint8_t i;
+
+	for (i = 0; i < CAN_BUS_BITRATE_COUNT; i++) {
+		if (bitrates[i] == bitrate) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void autobaud_try(uint8_t index) {
+	autobaud_index = index;
+	autobaud_frames = 0;
+	autobaud_start_time = msTicks;
+	CanBus_Configure(bitrates[index], true);
+	LPC_CCAN->STAT = CAN_BUS_STAT_LEC_UNUSED;
+}
+
+void CanBus_StartAutoBaud(void) {
+	autobaud_previous_bitrate = current_bitrate;
+	autobaud_previous_listen_only = listen_only;
+	autobaud_running = true;
+	autobaud_round = 0;
+	autobaud_try(0);
+}
+
+CAN_BUS_AUTOBAUD_T CanBus_UpdateAutoBaud(void) {
+	CCAN_MSG_OBJ_T msg_obj;
+	bool bus_error = false;
+	uint32_t ret;
+	uint32_t lec;
+
+	if (!autobaud_running) {
+		return CAN_BUS_AUTOBAUD_IDLE;
+	}
+
+	while ((ret = CanBus_Receive(&msg_obj, NULL)) == NO_CAN_ERROR) {
+		if (autobaud_frames < UINT8_MAX) {
+			autobaud_frames++;
+		}
+	}
+	lec = LPC_CCAN->STAT & CAN_BUS_STAT_LEC_MASK;
+	// at the wrong rate frames fail bit stuffing, form or CRC checks
+	if (ret != NO_RX_CAN_MESSAGE || (lec != CAN_BUS_STAT_LEC_NONE && lec != CAN_BUS_STAT_LEC_UNUSED)) {
+		bus_error = true;
+	}
+
+	if (!bus_error && autobaud_frames >= CAN_BUS_AUTOBAUD_MIN_FRAMES) {
+		autobaud_running = false;
+		CanBus_Configure(current_bitrate, autobaud_previous_listen_only);
+		return CAN_BUS_AUTOBAUD_FOUND;
+	}
+	if (!bus_error && msTicks - autobaud_start_time < CAN_BUS_AUTOBAUD_DWELL_MS) {
+		return CAN_BUS_AUTOBAUD_RUNNING;
+	}
+
+	if (autobaud_index + 1 < CAN_BUS_BITRATE_COUNT) {
+		autobaud_try(autobaud_index + 1);
+	} else if (++autobaud_round < CAN_BUS_AUTOBAUD_ROUNDS) {
+		autobaud_try(0);
+	} else {
+		autobaud_running = false;
+		CanBus_Configure(autobaud_previous_bitrate, autobaud_previous_listen_only);
+		return CAN_BUS_AUTOBAUD_FAILED;
+	}
+	return CAN_BUS_AUTOBAUD_RUNNING;
+}
+
+uint32_t CanBus_Receive(CCAN_MSG_OBJ_T * msg_obj, uint32_t * rx_cycles) {
+	uint32_t ret = CAN_Receive(msg_obj);
+	uint32_t stamp;
+
+	if (ret != NO_CAN_ERROR) {
+		return ret;
+	}
+	if (rx_stamp_head != rx_stamp_tail) {
+		stamp = rx_stamps[rx_stamp_tail % CAN_BUS_RX_STAMP_COUNT];
+		rx_stamp_tail++;
+	} else {
+		// can't happen while every insert is stamped, don't let the tail pass the head
+		stamp = Timebase_GetCycles();
+	}
+	if (rx_cycles != NULL) {
+		*rx_cycles = stamp;
+	}
+	return ret;
+}
+
+bool CanBus_RxPending(void) {
+	return rx_stamp_head != rx_stamp_tail;
+}
+
+RAMFUNC int CanBus_LibraryRxInsert(RINGBUFF_T * ring, const void * data) {
+	uint32_t now = Timebase_GetCycles();
+
+	if ((uint8_t) (rx_stamp_head - rx_stamp_tail) >= CAN_BUS_RX_STAMP_COUNT) {
+		return 0;
+	}
+	if (!RingBuffer_Insert(ring, data)) {
+		return 0;
+	}
+	// the main loop can't pop the frame before the interrupt returns
+	rx_stamps[rx_stamp_head % CAN_BUS_RX_STAMP_COUNT] = now;
+	rx_stamp_head++;
+	return 1;
+}
+
+bool CanBus_Transmit(uint32_t mode_id, const uint8_t * data, uint8_t dlc) {
+	CAN_BUS_TX_ENTRY_T frame;
+	bool queued;
+
+	if (listen_only) {
+		__disable_irq();
+		Seqlock_WriteBegin(&tx_stats_lock);
+		tx_stats.dropped++;
+		Seqlock_WriteEnd(&tx_stats_lock);
+		__enable_irq();
+		return false;
+	}
+	if (dlc > CAN_BUS_MAX_DLC) {
+		dlc = CAN_BUS_MAX_DLC;
+	}
+	frame.mode_id = mode_id;
+	frame.dlc = dlc;
+	memcpy(frame.data, data, dlc);
+	frame.queued_cycles = Timebase_GetCycles();
+
+	// the CAN interrupt and SysTick poll the queue too
+	__disable_irq();
+	Seqlock_WriteBegin(&tx_stats_lock);
+	queued = queue_insert(&frame);
+	if (queued) {
+		tx_stats.queued++;
+	} else {
+		tx_stats.dropped++;
+	}
+	poll(Timebase_GetCycles());
+	Seqlock_WriteEnd(&tx_stats_lock);
+	__enable_irq();
+
+	return queued;
+}
+
+RAMFUNC void CanBus_Poll(void) {
+	// the CAN interrupt preempts SysTick
+	__disable_irq();
+	Seqlock_WriteBegin(&tx_stats_lock);
+	poll(Timebase_GetCycles());
+	Seqlock_WriteEnd(&tx_stats_lock);
+	__enable_irq();
+}
+
+RAMFUNC void CAN_IRQHandler(void) {
+	// as close to the end of the frame as we get, the library handler
+	// takes a while
+	uint32_t now = Timebase_GetCycles();
+
+	CanBus_LibraryIRQHandler();
+	Seqlock_WriteBegin(&tx_stats_lock);
+	poll(now);
+	Seqlock_WriteEnd(&tx_stats_lock);
+}
+
+void CanBus_Dump(void) {
+	CAN_BUS_TX_STATS_T snapshot;
+	uint8_t depth;
+	uint32_t sequence;
+
+	do {
+		sequence = Seqlock_ReadBegin(&tx_stats_lock);
+		snapshot = tx_stats;
+		depth = tx_depth;
+	} while (Seqlock_ReadRetry(&tx_stats_lock, sequence));
+
+	DEBUG_Print("CAN tx queued: ");
+	DEBUG_PrintNumber(snapshot.queued, 10);
+	DEBUG_Print(", sent: ");
+	DEBUG_PrintNumber(snapshot.sent, 10);
+	DEBUG_Print(", dropped: ");
+	DEBUG_PrintNumber(snapshot.dropped, 10);
+	DEBUG_Print(", depth: ");
+	DEBUG_PrintNumber(depth, 10);
+	DEBUG_Print(" (max ");
+	DEBUG_PrintNumber(snapshot.max_depth, 10);
+	DEBUG_Print(")\r\n");
+	if (snapshot.sent != 0) {
+		DEBUG_Print("Latency to wire: min ");
+		DEBUG_PrintNumber(Timebase_CyclesToMicros(snapshot.min_latency_cycles), 10);
+		DEBUG_Print(" us, max ");
+		DEBUG_PrintNumber(Timebase_CyclesToMicros(snapshot.max_latency_cycles), 10);
+		DEBUG_Print(" us, avg ");
+		DEBUG_PrintNumber(Timebase_CyclesToMicros(snapshot.total_latency_cycles / snapshot.sent), 10);
+		DEBUG_Print(" us\r\n");
+	}
+}
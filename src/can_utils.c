@@ -2,27 +2,295 @@
 #include "ccand_11xx.h"
 #include "can_constants.h"
 
-void CAN_MakeBMSHeartbeat(BMS_HEARTBEAT_T * bms_heartbeat, CCAN_MSG_OBJ_T * msg_obj) {
+#define CAN_MAX_DLC 8
+
+typedef union {
+	uint8_t data[CAN_MAX_DLC];
+	uint64_t data_64;
+} CAN_PAYLOAD_T;
+
+/**
+ * @details lines a payload up with the end of an 8 byte one, so signal bit
+ * 0 is the most significant bit of the last byte sent. Copies byte by byte,
+ * a variable 64 bit shift is a libgcc call that runs from flash.
+ *
+ * @param data payload
+ * @param dlc payload length, longer counts as 8
+ * @return payload as data_64 of an 8 byte frame
+ */
+RAMFUNC static uint64_t align_payload(const uint8_t * data, uint8_t dlc) {
+	CAN_PAYLOAD_T aligned;
+	uint8_t i;
+
+	if (dlc > CAN_MAX_DLC) {
+		dlc = CAN_MAX_DLC;
+	}
+	aligned.data_64 = 0;
+	for (i = 0; i < dlc; i++) {
+		aligned.data[CAN_MAX_DLC - dlc + i] = data[i];
+	}
+	return aligned.data_64;
+}
+
+RAMFUNC void CAN_MakeBMSHeartbeat(BMS_HEARTBEAT_T * bms_heartbeat, CCAN_MSG_OBJ_T * msg_obj) {
+	const uint64_t data_64 = align_payload(msg_obj->data, msg_obj->dlc);
 	//get state
 	//get soc_percentage
 	//construct BMS_HEARTBEAT_T
 	const uint32_t CAN_message_highest_bit = 63;
 	const uint64_t soc_percentage_mask = 0x1FFC000000000000;
 	uint64_t state = 
-		msg_obj->data_64 >> (CAN_message_highest_bit - __BMS_HEARTBEAT__STATE__end);
-	uint64_t soc_percentage = (msg_obj->data_64 & soc_percentage_mask) >> 
+		data_64 >> (CAN_message_highest_bit - __BMS_HEARTBEAT__STATE__end);
+	uint64_t soc_percentage = (data_64 & soc_percentage_mask) >> 
 		(CAN_message_highest_bit - __BMS_HEARTBEAT__SOC_PERCENTAGE__end);
 
 	bms_heartbeat->state = state;
 	bms_heartbeat->soc_percentage = soc_percentage;
 }
 
-void CAN_MakeBMSDischargeResponse(BMS_DISCHARGE_RESPONSE_T * bms_discharge_response, CCAN_MSG_OBJ_T * msg_obj) {
+RAMFUNC void CAN_MakeBMSDischargeResponse(BMS_DISCHARGE_RESPONSE_T * bms_discharge_response, CCAN_MSG_OBJ_T * msg_obj) {
+	const uint64_t data_64 = align_payload(msg_obj->data, msg_obj->dlc);
         const uint32_t CAN_message_highest_bit = 63;
         const uint64_t bms_discharge_response_mask = 0x8000000000000000;
-        uint64_t discharge_response = (msg_obj->data_64 & bms_discharge_response_mask) >> 
+        uint64_t discharge_response = (data_64 & bms_discharge_response_mask) >> 
 		(CAN_message_highest_bit - __BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__end);
 
         bms_discharge_response->discharge_response = discharge_response;
 }
 
+
+/**
+ * @details extracts the signal occupying bits start..end of a CAN message,
+ * where bit 0 is the most significant bit of data_64. Signals are at most
+ * 32 bits wide.
+ *
+ * Works on the two 32 bit halves: a variable 64 bit shift is a libgcc call
+ * on the Cortex-M0, which would run from flash in the middle of this SRAM
+ * resident path.
+ */
+RAMFUNC static uint32_t extract_signal(uint64_t data_64, uint32_t start, uint32_t end) {
+	const uint32_t CAN_message_highest_bit = 63;
+	const uint32_t width = end - start + 1;
+	const uint32_t shift = CAN_message_highest_bit - end;
+	const uint32_t low = (uint32_t) data_64;
+	const uint32_t high = (uint32_t) (data_64 >> 32);
+	uint32_t value;
+
+	if (shift >= 32) {
+		value = high >> (shift - 32);
+	} else if (shift == 0) {
+		value = low;
+	} else {
+		value = (low >> shift) | (high << (32 - shift));
+	}
+	return width >= 32 ? value : value & ((1UL << width) - 1);
+}
+
+/**
+ * @details places value in bits start..end of a CAN message, the inverse of
+ * extract_signal. Bits of value beyond the signal width are dropped.
+ */
+static void insert_signal(uint64_t * data_64, uint32_t start, uint32_t end, uint64_t value) {
+	const uint32_t CAN_message_highest_bit = 63;
+	const uint32_t width = end - start + 1;
+	const uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+	const uint32_t shift = CAN_message_highest_bit - end;
+
+	*data_64 = (*data_64 & ~(mask << shift)) | ((value & mask) << shift);
+}
+
+/**
+ * @details starts an outgoing message: signals are numbered from the most
+ * significant bit of data_64, so all 8 bytes are always sent
+ */
+static void init_message(CCAN_MSG_OBJ_T * msg_obj, uint32_t mode_id) {
+	const uint8_t CAN_message_length = 8;
+
+	msg_obj->mode_id = mode_id;
+	msg_obj->dlc = CAN_message_length;
+	msg_obj->data_64 = 0;
+}
+
+RAMFUNC void CAN_MakeFrontCanNodeWheelSpeed(FRONT_CAN_NODE_WHEEL_SPEED_T * wheel_speed, CCAN_MSG_OBJ_T * msg_obj) {
+	const uint64_t data_64 = align_payload(msg_obj->data, msg_obj->dlc);
+	wheel_speed->front_right_wheel_speed = extract_signal(data_64,
+		__FRONT_CAN_NODE_WHEEL_SPEED__FRONT_RIGHT_WHEEL_SPEED__start,
+		__FRONT_CAN_NODE_WHEEL_SPEED__FRONT_RIGHT_WHEEL_SPEED__end);
+	wheel_speed->front_left_wheel_speed = extract_signal(data_64,
+		__FRONT_CAN_NODE_WHEEL_SPEED__FRONT_LEFT_WHEEL_SPEED__start,
+		__FRONT_CAN_NODE_WHEEL_SPEED__FRONT_LEFT_WHEEL_SPEED__end);
+}
+
+RAMFUNC void CAN_MakeFrontCanNodeAnalogSensors(FRONT_CAN_NODE_ANALOG_SENSORS_T * analog_sensors, CCAN_MSG_OBJ_T * msg_obj) {
+	const uint64_t data_64 = align_payload(msg_obj->data, msg_obj->dlc);
+	analog_sensors->right_accel = extract_signal(data_64,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__RIGHT_ACCEL__start,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__RIGHT_ACCEL__end);
+	analog_sensors->left_accel = extract_signal(data_64,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__LEFT_ACCEL__start,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__LEFT_ACCEL__end);
+	analog_sensors->front_brake = extract_signal(data_64,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__FRONT_BRAKE__start,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__FRONT_BRAKE__end);
+	analog_sensors->rear_brake = extract_signal(data_64,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__REAR_BRAKE__start,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__REAR_BRAKE__end);
+	analog_sensors->steering = extract_signal(data_64,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__STEERING__start,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__STEERING__end);
+}
+
+RAMFUNC void CAN_MakeBMSPackStatus(BMS_PACK_STATUS_T * bms_pack_status, CCAN_MSG_OBJ_T * msg_obj) {
+	const uint64_t data_64 = align_payload(msg_obj->data, msg_obj->dlc);
+	bms_pack_status->pack_voltage = extract_signal(data_64,
+		__BMS_PACK_STATUS__PACK_VOLTAGE__start,
+		__BMS_PACK_STATUS__PACK_VOLTAGE__end);
+	bms_pack_status->pack_current = extract_signal(data_64,
+		__BMS_PACK_STATUS__PACK_CURRENT__start,
+		__BMS_PACK_STATUS__PACK_CURRENT__end);
+	bms_pack_status->ave_cell_voltage = extract_signal(data_64,
+		__BMS_PACK_STATUS__AVE_CELL_VOLTAGE__start,
+		__BMS_PACK_STATUS__AVE_CELL_VOLTAGE__end);
+	bms_pack_status->min_cell_voltage = extract_signal(data_64,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE__start,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE__end);
+	bms_pack_status->min_cell_voltage_id = extract_signal(data_64,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE_ID__start,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE_ID__end);
+	bms_pack_status->max_cell_voltage = extract_signal(data_64,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE__start,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE__end);
+	bms_pack_status->max_cell_voltage_id = extract_signal(data_64,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE_ID__start,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE_ID__end);
+}
+
+RAMFUNC void CAN_MakeBMSCellTemps(BMS_CELL_TEMPS_T * bms_cell_temps, CCAN_MSG_OBJ_T * msg_obj) {
+	const uint64_t data_64 = align_payload(msg_obj->data, msg_obj->dlc);
+	bms_cell_temps->ave_cell_temp = extract_signal(data_64,
+		__BMS_CELL_TEMPS__AVE_CELL_TEMP__start,
+		__BMS_CELL_TEMPS__AVE_CELL_TEMP__end);
+	bms_cell_temps->min_cell_temp = extract_signal(data_64,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP__start,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP__end);
+	bms_cell_temps->min_cell_temp_id = extract_signal(data_64,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP_ID__start,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP_ID__end);
+	bms_cell_temps->max_cell_temp = extract_signal(data_64,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP__start,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP__end);
+	bms_cell_temps->max_cell_temp_id = extract_signal(data_64,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP_ID__start,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP_ID__end);
+}
+
+void CAN_EncodeBMSHeartbeat(CCAN_MSG_OBJ_T * msg_obj, const BMS_HEARTBEAT_T * bms_heartbeat) {
+	init_message(msg_obj, BMS_HEARTBEAT__id);
+	insert_signal(&msg_obj->data_64,
+		__BMS_HEARTBEAT__STATE__start,
+		__BMS_HEARTBEAT__STATE__end,
+		bms_heartbeat->state);
+	insert_signal(&msg_obj->data_64,
+		__BMS_HEARTBEAT__SOC_PERCENTAGE__start,
+		__BMS_HEARTBEAT__SOC_PERCENTAGE__end,
+		bms_heartbeat->soc_percentage);
+}
+
+void CAN_EncodeBMSDischargeResponse(CCAN_MSG_OBJ_T * msg_obj, const BMS_DISCHARGE_RESPONSE_T * bms_discharge_response) {
+	init_message(msg_obj, BMS_DISCHARGE_RESPONSE__id);
+	insert_signal(&msg_obj->data_64,
+		__BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__start,
+		__BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__end,
+		bms_discharge_response->discharge_response);
+}
+
+void CAN_EncodeBMSPackStatus(CCAN_MSG_OBJ_T * msg_obj, const BMS_PACK_STATUS_T * bms_pack_status) {
+	init_message(msg_obj, BMS_PACK_STATUS__id);
+	insert_signal(&msg_obj->data_64,
+		__BMS_PACK_STATUS__PACK_VOLTAGE__start,
+		__BMS_PACK_STATUS__PACK_VOLTAGE__end,
+		bms_pack_status->pack_voltage);
+	insert_signal(&msg_obj->data_64,
+		__BMS_PACK_STATUS__PACK_CURRENT__start,
+		__BMS_PACK_STATUS__PACK_CURRENT__end,
+		bms_pack_status->pack_current);
+	insert_signal(&msg_obj->data_64,
+		__BMS_PACK_STATUS__AVE_CELL_VOLTAGE__start,
+		__BMS_PACK_STATUS__AVE_CELL_VOLTAGE__end,
+		bms_pack_status->ave_cell_voltage);
+	insert_signal(&msg_obj->data_64,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE__start,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE__end,
+		bms_pack_status->min_cell_voltage);
+	insert_signal(&msg_obj->data_64,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE_ID__start,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE_ID__end,
+		bms_pack_status->min_cell_voltage_id);
+	insert_signal(&msg_obj->data_64,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE__start,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE__end,
+		bms_pack_status->max_cell_voltage);
+	insert_signal(&msg_obj->data_64,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE_ID__start,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE_ID__end,
+		bms_pack_status->max_cell_voltage_id);
+}
+
+void CAN_EncodeBMSCellTemps(CCAN_MSG_OBJ_T * msg_obj, const BMS_CELL_TEMPS_T * bms_cell_temps) {
+	init_message(msg_obj, BMS_CELL_TEMPS__id);
+	insert_signal(&msg_obj->data_64,
+		__BMS_CELL_TEMPS__AVE_CELL_TEMP__start,
+		__BMS_CELL_TEMPS__AVE_CELL_TEMP__end,
+		bms_cell_temps->ave_cell_temp);
+	insert_signal(&msg_obj->data_64,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP__start,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP__end,
+		bms_cell_temps->min_cell_temp);
+	insert_signal(&msg_obj->data_64,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP_ID__start,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP_ID__end,
+		bms_cell_temps->min_cell_temp_id);
+	insert_signal(&msg_obj->data_64,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP__start,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP__end,
+		bms_cell_temps->max_cell_temp);
+	insert_signal(&msg_obj->data_64,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP_ID__start,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP_ID__end,
+		bms_cell_temps->max_cell_temp_id);
+}
+
+const CAN_SIGNAL_DESCRIPTOR_T CAN_Signals[CAN_SIGNAL_COUNT] = {
+#define CAN_SIGNAL_DESCRIPTOR(message, signal) \
+	{message##__id, __##message##__##signal##__start, __##message##__##signal##__end},
+	CAN_SIGNALS(CAN_SIGNAL_DESCRIPTOR)
+#undef CAN_SIGNAL_DESCRIPTOR
+};
+
+RAMFUNC uint32_t CAN_ExtractSignal(const CCAN_MSG_OBJ_T * msg_obj, CAN_SIGNAL_T signal) {
+	const CAN_SIGNAL_DESCRIPTOR_T * descriptor = &CAN_Signals[signal];
+
+	return extract_signal(align_payload(msg_obj->data, msg_obj->dlc), descriptor->start, descriptor->end);
+}
+
+RAMFUNC bool CAN_SignalInFrame(CAN_SIGNAL_T signal, uint8_t dlc) {
+	return CAN_Signals[signal].end < (uint32_t) dlc * 8;
+}
+
+bool CAN_InsertSignal(uint8_t * data, uint8_t dlc, uint32_t start, uint32_t end, uint64_t value) {
+	CAN_PAYLOAD_T aligned;
+	uint8_t i;
+
+	if (dlc > CAN_MAX_DLC) {
+		dlc = CAN_MAX_DLC;
+	}
+	if (start > end || end >= (uint32_t) dlc * 8) {
+		return false;
+	}
+	aligned.data_64 = align_payload(data, dlc);
+	insert_signal(&aligned.data_64, start, end, value);
+	for (i = 0; i < dlc; i++) {
+		data[i] = aligned.data[CAN_MAX_DLC - dlc + i];
+	}
+	return true;
+}
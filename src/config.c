@@ -0,0 +1,84 @@
+#include <stddef.h>
+#include <string.h>
+#include "config.h"
+#include "chip.h"
+
+// IAP writes 256, 512, 1024 or 4096 bytes from word aligned RAM
+#define CONFIG_WRITE_SIZE 256
+
+typedef char config_fits_write_size[(sizeof(TESTER_CONFIG_T) <= CONFIG_WRITE_SIZE) ? 1 : -1];
+
+/**
+ * @details standard reflected CRC-32 (polynomial 0xEDB88320), computed
+ * bitwise since it only runs at boot and on save
+ */
+static uint32_t config_crc32(const uint8_t * data, uint32_t len) {
+	uint32_t crc = 0xFFFFFFFF;
+	uint32_t i;
+	uint8_t bit;
+
+	for (i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+
+static bool config_valid(const TESTER_CONFIG_T * config) {
+	return config->magic == CONFIG_MAGIC &&
+		config->version == CONFIG_VERSION &&
+		config->length == sizeof(TESTER_CONFIG_T) &&
+		config->crc == config_crc32((const uint8_t *) config, offsetof(TESTER_CONFIG_T, crc));
+}
+
+bool Config_Load(TESTER_CONFIG_T * config) {
+	const TESTER_CONFIG_T * stored = (const TESTER_CONFIG_T *) CONFIG_ADDRESS;
+
+	if (!config_valid(stored)) {
+		return false;
+	}
+	memcpy(config, stored, sizeof(TESTER_CONFIG_T));
+	return true;
+}
+
+bool Config_Erase(void) {
+	uint8_t ret;
+
+	__disable_irq();
+	ret = Chip_IAP_PreSectorForReadWrite(CONFIG_SECTOR, CONFIG_SECTOR);
+	if (ret == IAP_CMD_SUCCESS) {
+		ret = Chip_IAP_EraseSector(CONFIG_SECTOR, CONFIG_SECTOR);
+	}
+	__enable_irq();
+
+	return ret == IAP_CMD_SUCCESS;
+}
+
+bool Config_Save(TESTER_CONFIG_T * config) {
+	uint32_t write_buf[CONFIG_WRITE_SIZE / sizeof(uint32_t)];
+	uint8_t ret;
+
+	config->magic = CONFIG_MAGIC;
+	config->version = CONFIG_VERSION;
+	config->length = sizeof(TESTER_CONFIG_T);
+	config->crc = config_crc32((const uint8_t *) config, offsetof(TESTER_CONFIG_T, crc));
+
+	// erased flash reads as 0xFF, pad with the same
+	memset(write_buf, 0xFF, sizeof(write_buf));
+	memcpy(write_buf, config, sizeof(TESTER_CONFIG_T));
+
+	if (!Config_Erase()) {
+		return false;
+	}
+
+	__disable_irq();
+	ret = Chip_IAP_PreSectorForReadWrite(CONFIG_SECTOR, CONFIG_SECTOR);
+	if (ret == IAP_CMD_SUCCESS) {
+		ret = Chip_IAP_CopyRamToFlash(CONFIG_ADDRESS, write_buf, CONFIG_WRITE_SIZE);
+	}
+	__enable_irq();
+
+	return ret == IAP_CMD_SUCCESS && config_valid((const TESTER_CONFIG_T *) CONFIG_ADDRESS);
+}
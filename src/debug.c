@@ -0,0 +1,16 @@
+#include "debug.h"
+
+void DEBUG_PrintNumber(uint32_t value, uint8_t base) {
+	const uint8_t max_digit_count = 10;
+	char digits[max_digit_count + 1];
+	uint8_t i = max_digit_count;
+
+	digits[i] = '\0';
+	do {
+		uint8_t digit = value % base;
+		digits[--i] = digit < 10 ? '0' + digit : 'A' + digit - 10;
+		value /= base;
+	} while (value != 0 && i > 0);
+
+	DEBUG_Print(&digits[i]);
+}
@@ -0,0 +1,86 @@
+#include "dispatch.h"
+#include "arena.h"
+
+#define DISPATCH_TABLE_BITS 5
+
+typedef char dispatch_table_bits_match[((1 << DISPATCH_TABLE_BITS) == DISPATCH_TABLE_SIZE) ? 1 : -1];
+
+// the table lives in the arena (see arena.h)
+#define dispatch_table (arena.dispatch_table)
+
+static uint8_t registered;
+static uint32_t filter_id;
+static uint32_t filter_mask;
+
+/**
+ * @details Fibonacci hashing: the multiply spreads both the small standard
+ * ids and the clustered extended ids over the top bits. In RAM for
+ * Dispatch_Lookup.
+ */
+RAMFUNC static uint32_t dispatch_hash(uint32_t key) {
+	return (key * 2654435761UL) >> (32 - DISPATCH_TABLE_BITS);
+}
+
+void Dispatch_Init(void) {
+	uint8_t i;
+
+	for (i = 0; i < DISPATCH_TABLE_SIZE; i++) {
+		dispatch_table[i].handler = NULL;
+	}
+	registered = 0;
+	filter_id = 0;
+	filter_mask = 0;
+}
+
+bool Dispatch_Register(uint32_t mode_id, DISPATCH_HANDLER_T handler) {
+	uint32_t key = mode_id & DISPATCH_KEY_MASK;
+	uint32_t index = dispatch_hash(key);
+	uint8_t probes;
+
+	for (probes = 0; probes < DISPATCH_TABLE_SIZE; probes++) {
+		DISPATCH_ENTRY_T * entry = &dispatch_table[index];
+		if (entry->handler == NULL || entry->key == key) {
+			if (entry->handler == NULL) {
+				registered++;
+				Arena_Mark(ARENA_DISPATCH, registered * sizeof(DISPATCH_ENTRY_T));
+			}
+			entry->key = key;
+			entry->handler = handler;
+			return true;
+		}
+		index = (index + 1) & (DISPATCH_TABLE_SIZE - 1);
+	}
+	return false;
+}
+
+RAMFUNC DISPATCH_HANDLER_T Dispatch_Lookup(uint32_t mode_id) {
+	uint32_t key = mode_id & DISPATCH_KEY_MASK;
+	uint32_t index = dispatch_hash(key);
+	uint8_t probes;
+
+	for (probes = 0; probes < DISPATCH_TABLE_SIZE; probes++) {
+		const DISPATCH_ENTRY_T * entry = &dispatch_table[index];
+		if (entry->handler == NULL) {
+			return NULL;
+		}
+		if (entry->key == key) {
+			return entry->handler;
+		}
+		index = (index + 1) & (DISPATCH_TABLE_SIZE - 1);
+	}
+	return NULL;
+}
+
+void Dispatch_SetFilter(uint32_t id, uint32_t mask) {
+	filter_mask = mask & DISPATCH_KEY_MASK;
+	filter_id = id & filter_mask;
+}
+
+void Dispatch_GetFilter(uint32_t * id, uint32_t * mask) {
+	*id = filter_id;
+	*mask = filter_mask;
+}
+
+RAMFUNC bool Dispatch_Accepts(uint32_t mode_id) {
+	return (mode_id & filter_mask) == filter_id;
+}
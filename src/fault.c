@@ -0,0 +1,315 @@
+#include <string.h>
+#include "fault.h"
+#include "can_bus.h"
+#include "can_utils.h"
+#include "timebase.h"
+#include "debug.h"
+
+#define FAULT_ID_MASK (CAN_MSGOBJ_EXT | CAN_BUS_MAX_EXT_ID)
+#define FAULT_MAX_SIGNAL_BIT 63
+
+typedef struct {
+	FAULT_RULE_T rule;
+	uint8_t pattern_index;
+	uint32_t matched;
+	uint32_t injected;
+} FAULT_SLOT_T;
+
+typedef struct {
+	bool used;
+	bool reorder;
+	uint32_t held_time;
+	uint16_t wait_ms;
+	uint32_t mode_id;
+	uint8_t dlc;
+	uint8_t data[CAN_BUS_MAX_DLC];
+} FAULT_HELD_T;
+
+static const char * const action_names[] = {"none", "drop", "delay", "duplicate", "reorder", "corrupt"};
+
+static FAULT_SLOT_T slots[FAULT_RULE_COUNT];
+static FAULT_HELD_T held[FAULT_HELD_FRAMES];
+static uint32_t prng_state;
+
+// detection measurement, restarted whenever the rules change
+static bool awaiting_detection;
+static uint32_t first_fault_time;
+static bool detected;
+static uint32_t detection_ms;
+
+/**
+ * @details xorshift32, plenty for picking frames and repeatable from a seed
+ */
+static uint32_t next_random(void) {
+	uint32_t x = prng_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	prng_state = x;
+	return x;
+}
+
+static bool same_id(uint32_t a, uint32_t b) {
+	return (a & FAULT_ID_MASK) == (b & FAULT_ID_MASK);
+}
+
+static FAULT_SLOT_T * find_slot(uint32_t mode_id) {
+	uint8_t i;
+
+	for (i = 0; i < FAULT_RULE_COUNT; i++) {
+		if (slots[i].rule.action != FAULT_NONE && same_id(slots[i].rule.mode_id, mode_id)) {
+			return &slots[i];
+		}
+	}
+	return NULL;
+}
+
+static bool should_fault(FAULT_SLOT_T * slot) {
+	const FAULT_RULE_T * rule = &slot->rule;
+	bool fault;
+
+	if (rule->pattern_length == 0) {
+		return next_random() % 100 < rule->probability;
+	}
+	fault = (rule->pattern >> slot->pattern_index) & 1;
+	slot->pattern_index = (slot->pattern_index + 1) % rule->pattern_length;
+	return fault;
+}
+
+/**
+ * @return false if every held frame slot is taken
+ */
+static bool hold(uint32_t mode_id, const uint8_t * data, uint8_t dlc, uint16_t wait_ms, bool reorder) {
+	uint8_t i;
+
+	for (i = 0; i < FAULT_HELD_FRAMES; i++) {
+		FAULT_HELD_T * frame = &held[i];
+		if (!frame->used) {
+			frame->used = true;
+			frame->reorder = reorder;
+			frame->held_time = msTicks;
+			frame->wait_ms = wait_ms;
+			frame->mode_id = mode_id;
+			frame->dlc = dlc;
+			memcpy(frame->data, data, dlc);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void release(FAULT_HELD_T * frame) {
+	frame->used = false;
+	CanBus_Transmit(frame->mode_id, frame->data, frame->dlc);
+}
+
+/**
+ * @details sends the frames a reorder rule held back for this id, now that
+ * a later frame with the id went out ahead of them
+ */
+static void release_reordered(uint32_t mode_id) {
+	uint8_t i;
+
+	for (i = 0; i < FAULT_HELD_FRAMES; i++) {
+		if (held[i].used && held[i].reorder && same_id(held[i].mode_id, mode_id)) {
+			release(&held[i]);
+		}
+	}
+}
+
+static void record_injection(FAULT_SLOT_T * slot) {
+	slot->injected++;
+	if (!awaiting_detection && !detected) {
+		awaiting_detection = true;
+		first_fault_time = msTicks;
+	}
+}
+
+static void restart_detection(void) {
+	awaiting_detection = false;
+	detected = false;
+}
+
+void Fault_Init(void) {
+	memset(slots, 0, sizeof(slots));
+	memset(held, 0, sizeof(held));
+	Fault_Seed(FAULT_DEFAULT_SEED);
+	restart_detection();
+}
+
+bool Fault_SetRule(const FAULT_RULE_T * rule) {
+	FAULT_SLOT_T * slot = find_slot(rule->mode_id);
+	uint8_t i;
+
+	if (rule->action > FAULT_CORRUPT || rule->pattern_length > FAULT_MAX_PATTERN_LENGTH) {
+		return false;
+	}
+	if (rule->pattern_length == 0 && rule->probability > 100) {
+		return false;
+	}
+	if (rule->action == FAULT_CORRUPT && (rule->signal_start > rule->signal_end || rule->signal_end > FAULT_MAX_SIGNAL_BIT)) {
+		return false;
+	}
+
+	if (slot == NULL) {
+		if (rule->action == FAULT_NONE) {
+			return true;
+		}
+		for (i = 0; i < FAULT_RULE_COUNT && slot == NULL; i++) {
+			if (slots[i].rule.action == FAULT_NONE) {
+				slot = &slots[i];
+			}
+		}
+		if (slot == NULL) {
+			return false;
+		}
+	}
+
+	memset(slot, 0, sizeof(*slot));
+	slot->rule = *rule;
+	restart_detection();
+	return true;
+}
+
+void Fault_ClearRules(void) {
+	uint8_t i;
+
+	memset(slots, 0, sizeof(slots));
+	for (i = 0; i < FAULT_HELD_FRAMES; i++) {
+		if (held[i].used) {
+			release(&held[i]);
+		}
+	}
+	restart_detection();
+}
+
+void Fault_Seed(uint32_t seed) {
+	// xorshift never leaves 0
+	prng_state = seed != 0 ? seed : FAULT_DEFAULT_SEED;
+}
+
+bool Fault_Transmit(uint32_t mode_id, const uint8_t * data, uint8_t dlc) {
+	FAULT_SLOT_T * slot = find_slot(mode_id);
+	uint8_t corrupted[CAN_BUS_MAX_DLC];
+	bool sent;
+
+	if (slot == NULL) {
+		return CanBus_Transmit(mode_id, data, dlc);
+	}
+	if (dlc > CAN_BUS_MAX_DLC) {
+		dlc = CAN_BUS_MAX_DLC;
+	}
+
+	slot->matched++;
+	if (!should_fault(slot)) {
+		sent = CanBus_Transmit(mode_id, data, dlc);
+		release_reordered(mode_id);
+		return sent;
+	}
+
+	switch (slot->rule.action) {
+		case FAULT_DROP:
+			sent = true;
+			break;
+		case FAULT_DELAY:
+		case FAULT_REORDER:
+			if (slot->rule.action == FAULT_DELAY) {
+				sent = hold(mode_id, data, dlc, slot->rule.delay_ms, false);
+			} else {
+				sent = hold(mode_id, data, dlc, FAULT_REORDER_TIMEOUT_MS, true);
+			}
+			if (!sent) {
+				// nowhere to keep it, send it unharmed
+				return CanBus_Transmit(mode_id, data, dlc);
+			}
+			break;
+		case FAULT_DUPLICATE:
+			sent = CanBus_Transmit(mode_id, data, dlc);
+			CanBus_Transmit(mode_id, data, dlc);
+			break;
+		case FAULT_CORRUPT:
+			memcpy(corrupted, data, dlc);
+			if (!CAN_InsertSignal(corrupted, dlc, slot->rule.signal_start, slot->rule.signal_end, slot->rule.signal_value)) {
+				// the signal isn't in this frame, send it unharmed
+				return CanBus_Transmit(mode_id, data, dlc);
+			}
+			sent = CanBus_Transmit(mode_id, corrupted, dlc);
+			break;
+		default:
+			return CanBus_Transmit(mode_id, data, dlc);
+	}
+
+	record_injection(slot);
+	return sent;
+}
+
+bool Fault_Update(void) {
+	bool sent = false;
+	uint8_t i;
+
+	for (i = 0; i < FAULT_HELD_FRAMES; i++) {
+		FAULT_HELD_T * frame = &held[i];
+		if (frame->used && msTicks - frame->held_time >= frame->wait_ms) {
+			release(frame);
+			sent = true;
+		}
+	}
+	return sent;
+}
+
+void Fault_MarkDetected(void) {
+	if (!awaiting_detection) {
+		return;
+	}
+	awaiting_detection = false;
+	detected = true;
+	detection_ms = msTicks - first_fault_time;
+	DEBUG_Print("BMS detected the fault after ");
+	DEBUG_PrintNumber(detection_ms, 10);
+	DEBUG_Print(" ms\r\n");
+}
+
+void Fault_Dump(void) {
+	bool any = false;
+	uint8_t i;
+
+	for (i = 0; i < FAULT_RULE_COUNT; i++) {
+		const FAULT_SLOT_T * slot = &slots[i];
+		if (slot->rule.action == FAULT_NONE) {
+			continue;
+		}
+		any = true;
+		DEBUG_Print("Fault ");
+		DEBUG_PrintNumber(slot->rule.mode_id & CAN_BUS_MAX_EXT_ID, 16);
+		DEBUG_Print(": ");
+		DEBUG_Print(action_names[slot->rule.action]);
+		if (slot->rule.pattern_length == 0) {
+			DEBUG_Print(", ");
+			DEBUG_PrintNumber(slot->rule.probability, 10);
+			DEBUG_Print("%");
+		} else {
+			DEBUG_Print(", every ");
+			DEBUG_PrintNumber(slot->rule.pattern_length, 10);
+			DEBUG_Print(" frames");
+		}
+		DEBUG_Print(", matched ");
+		DEBUG_PrintNumber(slot->matched, 10);
+		DEBUG_Print(", injected ");
+		DEBUG_PrintNumber(slot->injected, 10);
+		DEBUG_Print("\r\n");
+	}
+	if (!any) {
+		DEBUG_Print("No fault rules\r\n");
+	}
+
+	if (detected) {
+		DEBUG_Print("BMS detected the fault after ");
+		DEBUG_PrintNumber(detection_ms, 10);
+		DEBUG_Print(" ms\r\n");
+	} else if (awaiting_detection) {
+		DEBUG_Print("First fault ");
+		DEBUG_PrintNumber(msTicks - first_fault_time, 10);
+		DEBUG_Print(" ms ago, not detected yet\r\n");
+	}
+}
@@ -0,0 +1,94 @@
+#include "idle.h"
+#include "serial.h"
+#include "can_bus.h"
+#include "timebase.h"
+#include "debug.h"
+#include "chip.h"
+
+static IDLE_STATS_T idle_stats;
+static bool idle_enabled;
+static bool awaiting_dispatch;
+static uint32_t wake_cycles;
+static uint32_t stats_start_time;
+
+void Idle_Init(bool enabled) {
+	memset(&idle_stats, 0, sizeof(idle_stats));
+	idle_enabled = enabled;
+	awaiting_dispatch = false;
+	stats_start_time = msTicks;
+}
+
+void Idle_SetEnabled(bool enabled) {
+	idle_enabled = enabled;
+}
+
+bool Idle_IsEnabled(void) {
+	return idle_enabled;
+}
+
+uint32_t Idle_Sleep(void) {
+	uint32_t sleep_start;
+
+	if (!idle_enabled) {
+		return 0;
+	}
+
+	sleep_start = Timebase_GetCycles();
+
+	// WFI still wakes on an interrupt that becomes pending while PRIMASK
+	// is set, so a byte or frame arriving after the check cannot be slept
+	// through, and one that arrived before it is seen here
+	__disable_irq();
+	if (!Serial_RxPending() && !CanBus_RxPending()) {
+		__WFI();
+	}
+	__enable_irq();
+
+	wake_cycles = Timebase_GetCycles();
+	awaiting_dispatch = true;
+	idle_stats.sleeps++;
+	idle_stats.sleep_cycles += wake_cycles - sleep_start;
+	return wake_cycles - sleep_start;
+}
+
+void Idle_MarkDispatch(uint32_t event_cycles) {
+	uint32_t latency;
+
+	if (!awaiting_dispatch) {
+		return;
+	}
+	awaiting_dispatch = false;
+
+	latency = Timebase_GetCycles() - event_cycles;
+	idle_stats.dispatches++;
+	idle_stats.total_wake_latency_cycles += latency;
+	if (latency > idle_stats.worst_wake_latency_cycles) {
+		idle_stats.worst_wake_latency_cycles = latency;
+	}
+}
+
+void Idle_Dump(void) {
+	IDLE_STATS_T snapshot = idle_stats;
+	uint64_t elapsed_cycles = (uint64_t)(msTicks - stats_start_time) * (SystemCoreClock / 1000);
+	const uint32_t percent = 100;
+
+	DEBUG_Print("Idle: ");
+	DEBUG_Print(idle_enabled ? "on" : "off");
+	DEBUG_Print(", sleeps: ");
+	DEBUG_PrintNumber(snapshot.sleeps, 10);
+	if (elapsed_cycles != 0) {
+		DEBUG_Print(", asleep: ");
+		DEBUG_PrintNumber(snapshot.sleep_cycles * percent / elapsed_cycles, 10);
+		DEBUG_Print("%");
+	}
+	DEBUG_Print("\r\nInterrupt to dispatch: ");
+	DEBUG_PrintNumber(snapshot.dispatches, 10);
+	if (snapshot.dispatches != 0) {
+		DEBUG_Print(" events, worst ");
+		DEBUG_PrintNumber(Timebase_CyclesToMicros(snapshot.worst_wake_latency_cycles), 10);
+		DEBUG_Print(" us, avg ");
+		DEBUG_PrintNumber(Timebase_CyclesToMicros(snapshot.total_wake_latency_cycles / snapshot.dispatches), 10);
+		DEBUG_Print(" us");
+	}
+	DEBUG_Print("\r\n");
+}
@@ -0,0 +1,144 @@
+#include "loop_monitor.h"
+#include "timebase.h"
+#include "debug.h"
+#include "chip.h"
+
+// first histogram bucket holds iterations shorter than 2^4 us, each
+// following bucket doubles the upper bound, the last one is open ended
+#define FIRST_BUCKET_SHIFT 4
+
+static LOOP_MONITOR_STATS_T loop_stats;
+static uint32_t loop_budget_us;
+static uint32_t last_tick_cycles;
+static uint32_t slept_cycles;
+static bool loop_started;
+
+static uint32_t pending_overruns;
+static uint32_t pending_worst_us;
+static uint32_t last_report_time;
+
+static uint8_t bucket_for(uint32_t elapsed_us) {
+	uint8_t bucket = 0;
+	elapsed_us >>= FIRST_BUCKET_SHIFT;
+	while (elapsed_us != 0 && bucket < LOOP_MONITOR_BUCKET_COUNT - 1) {
+		elapsed_us >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+#ifdef LOOP_WATCHDOG_ENABLE
+static void watchdog_init(void) {
+	// WDT runs from the 12 MHz IRC with a fixed divide by 4
+	const uint32_t wdt_ticks_per_ms = 12000000 / 4 / 1000;
+
+	Chip_Clock_SetWDTClockSource(SYSCTL_WDTCLKSRC_IRC, 1);
+	Chip_WWDT_Init(LPC_WWDT);
+	Chip_WWDT_SetTimeOut(LPC_WWDT, wdt_ticks_per_ms * LOOP_MONITOR_WATCHDOG_TIMEOUT_MS);
+	Chip_WWDT_SetOption(LPC_WWDT, WWDT_WDMOD_WDRESET);
+	Chip_WWDT_Start(LPC_WWDT);
+}
+#endif
+
+void LoopMonitor_Init(uint32_t budget_us) {
+	memset(&loop_stats, 0, sizeof(loop_stats));
+	loop_budget_us = budget_us;
+	loop_started = false;
+	slept_cycles = 0;
+	pending_overruns = 0;
+	pending_worst_us = 0;
+	last_report_time = msTicks;
+
+#ifdef LOOP_WATCHDOG_ENABLE
+	watchdog_init();
+#endif
+}
+
+void LoopMonitor_Tick(void) {
+	uint32_t now = Timebase_GetCycles();
+	uint32_t elapsed_us = Timebase_CyclesToMicros(now - last_tick_cycles - slept_cycles);
+	last_tick_cycles = now;
+	slept_cycles = 0;
+
+	if (!loop_started) {
+		loop_started = true;
+		return;
+	}
+
+	loop_stats.iterations++;
+	loop_stats.histogram[bucket_for(elapsed_us)]++;
+	if (elapsed_us > loop_stats.worst_us) {
+		loop_stats.worst_us = elapsed_us;
+	}
+
+	if (elapsed_us > loop_budget_us) {
+		loop_stats.overruns++;
+		pending_overruns++;
+		if (elapsed_us > pending_worst_us) {
+			pending_worst_us = elapsed_us;
+		}
+		return;
+	}
+
+#ifdef LOOP_WATCHDOG_ENABLE
+	Chip_WWDT_Feed(LPC_WWDT);
+#endif
+}
+
+void LoopMonitor_Slept(uint32_t sleep_cycles) {
+	slept_cycles += sleep_cycles;
+}
+
+void LoopMonitor_Report(void) {
+	if (pending_overruns == 0 || msTicks - last_report_time < LOOP_MONITOR_REPORT_PERIOD_MS) {
+		return;
+	}
+
+	DEBUG_Print("Loop overrun: ");
+	DEBUG_PrintNumber(pending_overruns, 10);
+	DEBUG_Print(" iterations over ");
+	DEBUG_PrintNumber(loop_budget_us, 10);
+	DEBUG_Print(" us, worst ");
+	DEBUG_PrintNumber(pending_worst_us, 10);
+	DEBUG_Print(" us\r\n");
+
+	pending_overruns = 0;
+	pending_worst_us = 0;
+	last_report_time = msTicks;
+}
+
+void LoopMonitor_SetBudget(uint32_t budget_us) {
+	loop_budget_us = budget_us;
+}
+
+uint32_t LoopMonitor_GetBudget(void) {
+	return loop_budget_us;
+}
+
+void LoopMonitor_Dump(void) {
+	LOOP_MONITOR_STATS_T snapshot = loop_stats;
+	uint8_t i;
+
+	DEBUG_Print("Loop iterations: ");
+	DEBUG_PrintNumber(snapshot.iterations, 10);
+	DEBUG_Print(", worst: ");
+	DEBUG_PrintNumber(snapshot.worst_us, 10);
+	DEBUG_Print(" us, overruns: ");
+	DEBUG_PrintNumber(snapshot.overruns, 10);
+	DEBUG_Print(" (budget ");
+	DEBUG_PrintNumber(loop_budget_us, 10);
+	DEBUG_Print(" us)\r\n");
+
+	for (i = 0; i < LOOP_MONITOR_BUCKET_COUNT; i++) {
+		if (i < LOOP_MONITOR_BUCKET_COUNT - 1) {
+			DEBUG_Print("< ");
+			DEBUG_PrintNumber(1UL << (i + FIRST_BUCKET_SHIFT), 10);
+		} else {
+			DEBUG_Print(">= ");
+			DEBUG_PrintNumber(1UL << (i + FIRST_BUCKET_SHIFT - 1), 10);
+		}
+		DEBUG_Print(" us: ");
+		DEBUG_PrintNumber(snapshot.histogram[i], 10);
+		DEBUG_Print("\r\n");
+	}
+}
@@ -5,6 +5,23 @@
 #include "can_constants.h"
 #include "can_utils.h"
 #include "ccand_11xx.h"
+#include "debug.h"
+#include "profile.h"
+#include "timebase.h"
+#include "loop_monitor.h"
+#include "serial.h"
+#include "idle.h"
+#include "telemetry.h"
+#include "config.h"
+#include "dispatch.h"
+#include "can_bus.h"
+#include "slcan.h"
+#include "bms_emulator.h"
+#include "arena.h"
+#include "script.h"
+#include "fault.h"
+#include "signal_db.h"
+#include "ramfunc.h"
 
 /*****************************************************************************
  * Private types/enumerations/variables
@@ -15,18 +32,32 @@
 
 #define UART_RX_BUFFER_SIZE 1 
 
-#define DEBUG_ENABLE
-
-#ifdef DEBUG_ENABLE
-    #define DEBUG_Print(str) Chip_UART_SendBlocking(LPC_USART, str, strlen(str))
-    #define DEBUG_Write(str, count) Chip_UART_SendBlocking(LPC_USART, str, count)
-#else
-    #define DEBUG_Print(str)
-    #define DEBUG_Write(str, count) 
-#endif
-
 #define CONFIGURE_VCU_HEARTBEAT 'v'
+#define SET_VCU_HEARTBEAT_PERIOD 'H'
 #define SEND_DISCHARGE_REQUEST 'd'
+#define PRINT_PROFILE 'p'
+#define PRINT_LOOP_STATS 'l'
+#define SET_LOOP_BUDGET 'b'
+#define TOGGLE_IDLE 'i'
+#define CONFIGURE_TELEMETRY 'r'
+#define NEGOTIATE_BAUD 'B'
+#define THROUGHPUT_TEST 'x'
+#define SAVE_CONFIG 'W'
+#define ERASE_CONFIG 'E'
+#define SEND_RAW_FRAME 'T'
+#define SET_FILTER 'F'
+#define ENTER_GATEWAY 'G'
+#define TOGGLE_GATEWAY_AT_BOOT 'g'
+#define TOGGLE_BMS_EMULATOR 'e'
+#define SET_BMS_RESPONSE_LATENCY 'y'
+#define SET_BMS_TRAJECTORY 'j'
+#define PRINT_MEMORY 'm'
+#define UPLOAD_SCRIPT 'S'
+#define RUN_SCRIPT 'R'
+#define PRINT_TX_QUEUE 'q'
+#define SET_FAULT_RULE 'f'
+#define SET_CAN_BITRATE 'c'
+#define TOGGLE_LISTEN_ONLY 'L'
 #define HELP 'h'
 
 #define SEND_STANDBY_VCU_HEARTBEAT 's'
@@ -34,6 +65,11 @@
 #define DONT_SEND_VCU_HEARTBEAT 'n'
 
 #define BAUDRATE 115200
+#define BAUD_CONFIRM_KEY 'U'
+#define BAUD_CONFIRM_TIMEOUT_MS 2000
+// largest relative baud error (in percent) a UART receiver reliably tolerates
+#define BAUD_MAX_ERROR_PERCENT 3
+#define THROUGHPUT_TEST_BYTES 65536
 
 #define CONFIGURE_VCU_HEARTBEAT_HELP_MESSAGE "Enter 's' to send VCU heartbeats with Standby state.\r\nEnter 'd' to send VCU heartbeats with Discharge state.\r\nEnter 'n' to stop sending VCU heartbeats.\r\n"
 
@@ -41,17 +77,54 @@
 #define SEND_VCU_HEARTBEAT_DISCHARGE_MESSAGE "Sending VCU heartbeat with Discharge state\r\n"
 #define DONT_SEND_VCU_HEARTBEAT_MESSAGE "Not sending VCU heartbeat\r\n"
 #define UNRECOGNIZED_STATE_CONFIGURE_VCU_HEARTBEAT_MESSAGE "Unrecognized state. Please enter 's', 'd', or 'n'.\r\n"
+#define SET_VCU_HEARTBEAT_PERIOD_HELP_MESSAGE "Enter the VCU heartbeat period in milliseconds (0 to stop sending), then press enter.\r\n"
+#define INVALID_VCU_HEARTBEAT_PERIOD_MESSAGE "Invalid heartbeat period.\r\n"
+
+#define SET_LOOP_BUDGET_HELP_MESSAGE "Enter the main loop budget in microseconds, then press enter.\r\n"
+#define INVALID_LOOP_BUDGET_MESSAGE "Invalid loop budget.\r\n"
+
+#define CONFIGURE_TELEMETRY_HELP_MESSAGE "Enter the index of the signal to configure.\r\n"
+#define INVALID_TELEMETRY_SIGNAL_MESSAGE "Unrecognized signal index.\r\n"
+#define SET_TELEMETRY_PERIOD_HELP_MESSAGE "Enter the output period in milliseconds (0 to disable), then press enter.\r\n"
+#define INVALID_TELEMETRY_PERIOD_MESSAGE "Invalid telemetry period.\r\n"
+
+#define NEGOTIATE_BAUD_HELP_MESSAGE "Enter '1' for 115200, '2' for 230400, '4' for 460800 or '9' for 921600 baud.\r\nThen reopen the port at the new rate and send 'U' within 2 seconds.\r\n"
+#define UNRECOGNIZED_BAUD_MESSAGE "Unrecognized baud rate.\r\n"
+
+#define SET_CAN_BITRATE_HELP_MESSAGE "Enter '1' for 125k, '2' for 250k, '5' for 500k or 'M' for 1M bit/s, or 'a' to detect the bus bit rate.\r\n"
+#define UNRECOGNIZED_CAN_BITRATE_MESSAGE "Unrecognized CAN bit rate.\r\n"
+#define DETECTING_CAN_BITRATE_MESSAGE "Still detecting the CAN bit rate.\r\n"
+
+#define SEND_RAW_FRAME_HELP_MESSAGE "Enter a frame as <id>#<data>, e.g. 123#DEADBEEF or 18FF50E5#01, then press enter.\r\nIds with more than 3 digits are sent as 29 bit ids.\r\n"
+#define SET_FILTER_HELP_MESSAGE "Enter a filter as <id>:<mask>, e.g. 260:7F0 or 18FF0000:1FFF0000, or just press enter to accept everything.\r\n"
+#define INVALID_FRAME_MESSAGE "Invalid frame.\r\n"
+#define INVALID_FILTER_MESSAGE "Invalid filter.\r\n"
+#define TX_QUEUE_FULL_MESSAGE "Transmit queue full, frame dropped.\r\n"
+#define LISTEN_ONLY_MESSAGE "Listening only, frame not sent.\r\n"
+
+#define SET_BMS_RESPONSE_LATENCY_HELP_MESSAGE "Enter the discharge response latency in milliseconds, then press enter.\r\n"
+#define INVALID_BMS_RESPONSE_LATENCY_MESSAGE "Invalid response latency.\r\n"
+#define SET_BMS_TRAJECTORY_HELP_MESSAGE "Enter <signal> <shape> <from> <to> <period ms>, e.g. 0 r 1000 0 600000, then press enter.\r\nSignals: 0 SOC, 1 pack voltage, 2 pack current, 3-5 ave/min/max cell voltage, 6-8 ave/min/max cell temp.\r\nShapes: c constant, r ramp, t triangle, s square.\r\n"
+#define INVALID_BMS_TRAJECTORY_MESSAGE "Invalid trajectory.\r\n"
+
+#define SET_FAULT_RULE_HELP_MESSAGE "Enter <id> <action> <p<percent>|b<pattern>> [<delay ms>|<start> <end> <value>], e.g. 300 d b0011 or 300 c p20 0 7 255, then press enter.\r\nActions: d drop, l delay, u duplicate, o reorder, c corrupt signal, n remove the rule.\r\nEnter s <seed> to reseed, or just press enter to remove all rules.\r\n"
+#define INVALID_FAULT_RULE_MESSAGE "Invalid fault rule.\r\n"
+
+#define UPLOAD_SCRIPT_HELP_MESSAGE "Send the script as <length, 2 bytes> <script> <checksum>.\r\n"
+
+#define ENTER_GATEWAY_MESSAGE "SLCAN gateway mode, send ESC to return to this menu.\r\n"
+
+#define MENU_LINE_SIZE 32
 
 const uint32_t OscRateIn = 12000000;
 
 volatile uint32_t msTicks;
 
 CCAN_MSG_OBJ_T rx_msg;
-uint8_t str[100];
+// when rx_msg was received, for the handlers
+uint32_t rx_msg_cycles;
 uint8_t uart_rx_buf[UART_RX_BUFFER_SIZE];
 
-uint8_t Rx_Buf[8];
-
 enum VCU_STATE {
 	STANDBY,
 	DISCHARGE,
@@ -60,28 +133,70 @@ enum VCU_STATE {
 
 enum VCU_STATE VCU_STATE_T = STANDBY;
 
+enum MENU_STATE {
+	MENU_TOP,
+	MENU_VCU_HEARTBEAT,
+	MENU_VCU_HEARTBEAT_PERIOD,
+	MENU_LOOP_BUDGET,
+	MENU_TELEMETRY_SIGNAL,
+	MENU_TELEMETRY_PERIOD,
+	MENU_BAUD_SELECT,
+	MENU_BAUD_CONFIRM,
+	MENU_CAN_BITRATE,
+	MENU_SEND_RAW_FRAME,
+	MENU_SET_FILTER,
+	MENU_BMS_RESPONSE_LATENCY,
+	MENU_BMS_TRAJECTORY,
+	MENU_FAULT_RULE,
+	MENU_SCRIPT_UPLOAD
+};
+
+enum MENU_STATE menu_state = MENU_TOP;
+uint32_t menu_number;
+bool menu_number_overflow;
+TELEMETRY_SIGNAL_T menu_telemetry_signal;
+char menu_line[MENU_LINE_SIZE];
+uint8_t menu_line_length;
+
+uint32_t script_upload_time;
+bool script_upload_rejected;
+
+uint32_t previous_baudrate;
+uint32_t baud_change_time;
+
+uint32_t throughput_remaining;
+uint32_t throughput_start_time;
+
 uint32_t last_bms_heartbeat_time = 0;
+uint16_t vcu_heartbeat_period_ms = 1000 / VCU_HEARTBEAT__freq;
+
+bool gateway_at_boot = false;
+bool detecting_can_bitrate = false;
+
+TESTER_CONFIG_T tester_config;
 
 /*****************************************************************************
  * Private functions
  ****************************************************************************/
 
-void SysTick_Handler(void) {
+RAMFUNC void SysTick_Handler(void) {
     msTicks++;
+    CanBus_Poll();
 }
 
 /**
  * @details prints contents of UART buffer
  */
 static void Print_Buffer(uint8_t* buff, uint8_t buff_size) {
-    Chip_UART_SendBlocking(LPC_USART, "0x", 2);
+    char str[3];
+    DEBUG_Write("0x", 2);
     uint8_t i;
     for(i = 0; i < buff_size; i++) {
         itoa(buff[i], str, 16);
         if(buff[i] < 16) {
-            Chip_UART_SendBlocking(LPC_USART, "0", 1);
+            DEBUG_Write("0", 1);
         }
-        Chip_UART_SendBlocking(LPC_USART, str, 2);
+        DEBUG_Write(str, 2);
     }
 }
 
@@ -113,13 +228,13 @@ void sendBMSHeartbeat(void) {
 			; //empty statement
 			data = 0x1 << 7;
 			length = 1;
-			CAN_Transmit(VCU_HEARTBEAT__id, &data, length );
+			Fault_Transmit(VCU_HEARTBEAT__id, &data, length );
 			break;
 		case DISCHARGE:
 			; //empty statement
 			data = 0x0 << 7;
                         length = 1;
-                        CAN_Transmit(VCU_HEARTBEAT__id, &data, length );
+                        Fault_Transmit(VCU_HEARTBEAT__id, &data, length );
 			break;
 		case NONE:
 			//Do nothing
@@ -131,86 +246,1145 @@ void sendBMSHeartbeat(void) {
 }
 
 /**
- * @details reads incoming CAN messages and prints information to the terminal
+ * @details prints the state and state of charge of a BMS heartbeat
+ *
+ * @param msg_obj received CAN message
  */
-void Process_CAN_Inputs(void) {	
-	uint32_t ret;
+static void Handle_BMS_Heartbeat(CCAN_MSG_OBJ_T * msg_obj) {
 	BMS_HEARTBEAT_T bms_heartbeat;
+
+	DEBUG_Print("BMS Heartbeat\r\n");
+	PROFILE_Enter(PROFILE_MAKE_BMS_HEARTBEAT);
+	CAN_MakeBMSHeartbeat(&bms_heartbeat, msg_obj);
+	PROFILE_Exit(PROFILE_MAKE_BMS_HEARTBEAT);
+	switch (bms_heartbeat.state) {
+		case ____BMS_HEARTBEAT__STATE__INIT:
+			DEBUG_Print("BMS State: Init\r\n");
+			print_soc_percentage(bms_heartbeat.soc_percentage);
+			break;
+		case ____BMS_HEARTBEAT__STATE__STANDBY:
+			DEBUG_Print("BMS State: Standby\r\n");
+			print_soc_percentage(bms_heartbeat.soc_percentage);
+			break;
+		case ____BMS_HEARTBEAT__STATE__CHARGE:
+			DEBUG_Print("BMS State: Charge\r\n");
+			print_soc_percentage(bms_heartbeat.soc_percentage);
+			break;
+		case ____BMS_HEARTBEAT__STATE__BALANCE:
+			DEBUG_Print("BMS State: Balance\r\n");
+			print_soc_percentage(bms_heartbeat.soc_percentage);
+			break;
+		case ____BMS_HEARTBEAT__STATE__DISCHARGE:
+			DEBUG_Print("BMS State: Discharge\r\n");
+			print_soc_percentage(bms_heartbeat.soc_percentage);
+			break;
+		case ____BMS_HEARTBEAT__STATE__ERROR:
+			DEBUG_Print("BMS State: Error\r\n");
+			print_soc_percentage(bms_heartbeat.soc_percentage);
+			Fault_MarkDetected();
+			break;
+		default:
+			DEBUG_Print("Unexpected BMS State. You should never reach here\r\n");
+			break;
+	}
+}
+
+/**
+ * @details prints a BMS discharge response
+ *
+ * @param msg_obj received CAN message
+ */
+static void Handle_BMS_Discharge_Response(CCAN_MSG_OBJ_T * msg_obj) {
 	BMS_DISCHARGE_RESPONSE_T bms_discharge_response;
 
-	ret = CAN_Receive(&rx_msg);
-
-        if (ret == NO_CAN_ERROR) {
-        	switch (rx_msg.mode_id) {
-                	case BMS_HEARTBEAT__id:
-                        	DEBUG_Print("BMS Heartbeat\r\n");
-                        	CAN_MakeBMSHeartbeat(&bms_heartbeat, &rx_msg);
-                        	switch (bms_heartbeat.state) {
-                                	case ____BMS_HEARTBEAT__STATE__INIT:
-                                        	DEBUG_Print("BMS State: Init\r\n");
-                                                print_soc_percentage(bms_heartbeat.soc_percentage);
-                                                break;
-                                        case ____BMS_HEARTBEAT__STATE__STANDBY:
-                                                DEBUG_Print("BMS State: Standby\r\n");
-                                                print_soc_percentage(bms_heartbeat.soc_percentage);
-                                                break;
-                                        case ____BMS_HEARTBEAT__STATE__CHARGE:
-                                                DEBUG_Print("BMS State: Charge\r\n");
-                                                print_soc_percentage(bms_heartbeat.soc_percentage);
-                                                break;
-                               	        case ____BMS_HEARTBEAT__STATE__BALANCE:
-                                                DEBUG_Print("BMS State: Balance\r\n");
-                                                print_soc_percentage(bms_heartbeat.soc_percentage);
-                                                break;
-                                        case ____BMS_HEARTBEAT__STATE__DISCHARGE:
-                                                DEBUG_Print("BMS State: Discharge\r\n");
-                                                print_soc_percentage(bms_heartbeat.soc_percentage);
-                                                break;
-                                        case ____BMS_HEARTBEAT__STATE__ERROR:
-                                                DEBUG_Print("BMS State: Error\r\n");
-                                                print_soc_percentage(bms_heartbeat.soc_percentage);
-                                                break;
-                                        default:
-                                                DEBUG_Print("Unexpected BMS State. You should never reach here\r\n");
-                                                break;
-                                        }
-                                        break;
-
-			case BMS_DISCHARGE_RESPONSE__id:
-                        	DEBUG_Print("BMS Discharge Response\r\n");
-                      	        CAN_MakeBMSDischargeResponse(&bms_discharge_response, &rx_msg);
-                                switch (bms_discharge_response.discharge_response) {
-	                                case ____BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__NOT_READY:
-                                        	DEBUG_Print("Not Ready\r\n");
-                                                break;
-                                        case ____BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__READY:
-                                                DEBUG_Print("Ready\r\n");
-                                                break;
-                                        }
-                                        break;
-
-                        case BMS_PACK_STATUS__id:
-        	                DEBUG_Print("BMS Pack Status\r\n");
-       	                        //TODO
-                                break;
-                        case BMS_CELL_TEMPS__id:
-                                DEBUG_Print("BMS Cell Temp\r\n");
-                                //TODO
-                       	        break;
-                        case BMS_ERRORS__id:
-                                DEBUG_Print("BMS Errors\r\n");
-                                //TODO
-                                break;
-                        default:
-                        	DEBUG_Print("Unrecognized CAN message\r\n");
+	DEBUG_Print("BMS Discharge Response\r\n");
+	CAN_MakeBMSDischargeResponse(&bms_discharge_response, msg_obj);
+	switch (bms_discharge_response.discharge_response) {
+		case ____BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__NOT_READY:
+			DEBUG_Print("Not Ready\r\n");
+			break;
+		case ____BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__READY:
+			DEBUG_Print("Ready\r\n");
+			break;
+	}
+}
+
+/**
+ * @details feeds BMS pack status signals to the telemetry downsampler
+ *
+ * @param msg_obj received CAN message
+ */
+static void Handle_BMS_Pack_Status(CCAN_MSG_OBJ_T * msg_obj) {
+	BMS_PACK_STATUS_T bms_pack_status;
+
+	CAN_MakeBMSPackStatus(&bms_pack_status, msg_obj);
+	Telemetry_Sample(TELEMETRY_PACK_VOLTAGE, bms_pack_status.pack_voltage);
+	Telemetry_Sample(TELEMETRY_PACK_CURRENT, bms_pack_status.pack_current);
+	Telemetry_Sample(TELEMETRY_AVE_CELL_VOLTAGE, bms_pack_status.ave_cell_voltage);
+	Telemetry_Sample(TELEMETRY_MIN_CELL_VOLTAGE, bms_pack_status.min_cell_voltage);
+	Telemetry_Sample(TELEMETRY_MAX_CELL_VOLTAGE, bms_pack_status.max_cell_voltage);
+}
+
+/**
+ * @param msg_obj received CAN message
+ */
+static void Handle_BMS_Cell_Temps(CCAN_MSG_OBJ_T * msg_obj) {
+	(void) msg_obj;
+	DEBUG_Print("BMS Cell Temp\r\n");
+	//TODO
+}
+
+/**
+ * @param msg_obj received CAN message
+ */
+static void Handle_BMS_Errors(CCAN_MSG_OBJ_T * msg_obj) {
+	(void) msg_obj;
+	DEBUG_Print("BMS Errors\r\n");
+	Fault_MarkDetected();
+	//TODO
+}
+
+/**
+ * @details feeds front wheel speeds to the telemetry downsampler
+ *
+ * @param msg_obj received CAN message
+ */
+static void Handle_Wheel_Speed(CCAN_MSG_OBJ_T * msg_obj) {
+	FRONT_CAN_NODE_WHEEL_SPEED_T wheel_speed;
+
+	CAN_MakeFrontCanNodeWheelSpeed(&wheel_speed, msg_obj);
+	Telemetry_Sample(TELEMETRY_FRONT_RIGHT_WHEEL_SPEED, wheel_speed.front_right_wheel_speed);
+	Telemetry_Sample(TELEMETRY_FRONT_LEFT_WHEEL_SPEED, wheel_speed.front_left_wheel_speed);
+}
+
+/**
+ * @details feeds front analog sensor readings to the telemetry downsampler
+ *
+ * @param msg_obj received CAN message
+ */
+static void Handle_Analog_Sensors(CCAN_MSG_OBJ_T * msg_obj) {
+	FRONT_CAN_NODE_ANALOG_SENSORS_T analog_sensors;
+
+	CAN_MakeFrontCanNodeAnalogSensors(&analog_sensors, msg_obj);
+	Telemetry_Sample(TELEMETRY_RIGHT_ACCEL, analog_sensors.right_accel);
+	Telemetry_Sample(TELEMETRY_LEFT_ACCEL, analog_sensors.left_accel);
+	Telemetry_Sample(TELEMETRY_FRONT_BRAKE, analog_sensors.front_brake);
+	Telemetry_Sample(TELEMETRY_REAR_BRAKE, analog_sensors.rear_brake);
+	Telemetry_Sample(TELEMETRY_STEERING, analog_sensors.steering);
+}
+
+/**
+ * @details answers the request when emulating the BMS
+ *
+ * @param msg_obj received CAN message
+ */
+static void Handle_VCU_Discharge_Request(CCAN_MSG_OBJ_T * msg_obj) {
+	(void) msg_obj;
+	if (BmsEmulator_IsActive()) {
+		BmsEmulator_DischargeRequested(rx_msg_cycles);
+	} else {
+		DEBUG_Print("VCU Discharge Request\r\n");
+	}
+}
+
+/**
+ * @details registers the handler of every message the tester understands
+ */
+static void Register_CAN_Handlers(void) {
+	Dispatch_Init();
+	Dispatch_Register(BMS_HEARTBEAT__id, Handle_BMS_Heartbeat);
+	Dispatch_Register(BMS_DISCHARGE_RESPONSE__id, Handle_BMS_Discharge_Response);
+	Dispatch_Register(BMS_PACK_STATUS__id, Handle_BMS_Pack_Status);
+	Dispatch_Register(BMS_CELL_TEMPS__id, Handle_BMS_Cell_Temps);
+	Dispatch_Register(BMS_ERRORS__id, Handle_BMS_Errors);
+	Dispatch_Register(FRONT_CAN_NODE_WHEEL_SPEED__id, Handle_Wheel_Speed);
+	Dispatch_Register(FRONT_CAN_NODE_ANALOG_SENSORS__id, Handle_Analog_Sensors);
+	Dispatch_Register(VCU_DISCHARGE_REQUEST__id, Handle_VCU_Discharge_Request);
+}
+
+/**
+ * @details explains why a frame typed by the user was not sent
+ */
+static void print_transmit_failure(void) {
+	DEBUG_Print(CanBus_IsListenOnly() ? LISTEN_ONLY_MESSAGE : TX_QUEUE_FULL_MESSAGE);
+}
+
+/**
+ * @details moves bit rate detection on and reports its outcome
+ *
+ * @return true when detection ended
+ */
+static bool Process_CAN_Bitrate_Detection(void) {
+	switch (CanBus_UpdateAutoBaud()) {
+		case CAN_BUS_AUTOBAUD_FOUND:
+			DEBUG_Print("Detected ");
+			break;
+		case CAN_BUS_AUTOBAUD_FAILED:
+			DEBUG_Print("No bit rate detected, staying at ");
+			break;
+		default:
+			return false;
+	}
+	detecting_can_bitrate = false;
+	DEBUG_PrintNumber(CanBus_GetBitrate(), 10);
+	DEBUG_Print(" bit/s\r\n");
+	return true;
+}
+
+/**
+ * @details prints a CAN id, 3 hex digits for standard ids and 8 for extended ids
+ *
+ * @param mode_id message id as received in CCAN_MSG_OBJ_T
+ */
+static void print_can_id(uint32_t mode_id) {
+	const uint8_t std_digits = 3;
+	const uint8_t ext_digits = 8;
+	bool extended = mode_id & CAN_MSGOBJ_EXT;
+	uint32_t id = mode_id & CAN_BUS_MAX_EXT_ID;
+	int8_t digit;
+
+	for (digit = (extended ? ext_digits : std_digits) - 1; digit >= 0; digit--) {
+		DEBUG_PrintNumber((id >> (digit * 4)) & 0xF, 16);
+	}
+}
+
+/**
+ * @details reads incoming CAN messages and prints information to the terminal
+ *
+ * @return true if a CAN message was received
+ */
+bool Process_CAN_Inputs(void) {	
+	uint32_t ret;
+	DISPATCH_HANDLER_T handler;
+
+	if (detecting_can_bitrate) {
+		return Process_CAN_Bitrate_Detection();
+	}
+
+	ret = CanBus_Receive(&rx_msg, &rx_msg_cycles);
+
+	if (ret == NO_CAN_ERROR) {
+		Idle_MarkDispatch(rx_msg_cycles);
+		// a running script and the signal table see every frame, the filter
+		// only affects what's printed
+		Script_Receive(&rx_msg, rx_msg_cycles);
+		SignalDb_Update(&rx_msg, Timebase_MillisAt(rx_msg_cycles));
+		if (!Dispatch_Accepts(rx_msg.mode_id)) {
+			return true;
+		}
+
+		handler = Dispatch_Lookup(rx_msg.mode_id);
+		if (handler != NULL) {
+			handler(&rx_msg);
+		} else {
+			DEBUG_Print("Unrecognized CAN message ");
+			print_can_id(rx_msg.mode_id);
+			DEBUG_Print("\r\n");
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @details handles the key entered after 'v'
+ *
+ * @param key key received over UART
+ */
+static void Process_VCU_Heartbeat_Menu(uint8_t key) {
+	menu_state = MENU_TOP;
+	switch (key) {
+		case SEND_STANDBY_VCU_HEARTBEAT:
+			VCU_STATE_T = STANDBY;
+			DEBUG_Print(SEND_VCU_HEARTBEAT_STANDBY_MESSAGE);
+			break;
+		case SEND_DISCHARGE_VCU_HEARTBEAT:
+			VCU_STATE_T = DISCHARGE;
+			DEBUG_Print(SEND_VCU_HEARTBEAT_DISCHARGE_MESSAGE);
+			break;
+		case DONT_SEND_VCU_HEARTBEAT:
+			VCU_STATE_T = NONE;
+			DEBUG_Print(DONT_SEND_VCU_HEARTBEAT_MESSAGE);
+			break;
+		default:
+			DEBUG_Print(UNRECOGNIZED_STATE_CONFIGURE_VCU_HEARTBEAT_MESSAGE);
+			break;
+	}
+}
+
+/**
+ * @details handles the signal index entered after 'r'
+ *
+ * @param key key received over UART
+ */
+static void Process_Telemetry_Signal_Menu(uint8_t key) {
+	uint8_t signal = TELEMETRY_SIGNAL_COUNT;
+
+	if (key >= '0' && key <= '9') {
+		signal = key - '0';
+	} else if (key >= 'a' && key <= 'f') {
+		signal = key - 'a' + 10;
+	} else if (key >= 'A' && key <= 'F') {
+		signal = key - 'A' + 10;
+	}
+
+	if (signal >= TELEMETRY_SIGNAL_COUNT) {
+		menu_state = MENU_TOP;
+		DEBUG_Print(INVALID_TELEMETRY_SIGNAL_MESSAGE);
+		return;
+	}
+
+	menu_telemetry_signal = signal;
+	menu_number = 0;
+	menu_state = MENU_TELEMETRY_PERIOD;
+	DEBUG_Print(SET_TELEMETRY_PERIOD_HELP_MESSAGE);
+}
+
+/**
+ * @details accumulates the digits of a number and applies it to the
+ * setting being edited once enter is pressed
+ *
+ * @param key key received over UART
+ */
+static void Process_Number_Menu(uint8_t key) {
+	enum MENU_STATE edited = menu_state;
+	bool entered = key == '\r' || key == '\n';
+
+	if (key >= '0' && key <= '9') {
+		// stop at the limit instead of wrapping, the entry is then rejected
+		if (menu_number > (UINT32_MAX - (key - '0')) / 10) {
+			menu_number_overflow = true;
+		} else if (!menu_number_overflow) {
+			menu_number = menu_number * 10 + (key - '0');
+		}
+		return;
+	}
+
+	if (menu_number_overflow) {
+		entered = false;
+		menu_number_overflow = false;
+	}
+	menu_state = MENU_TOP;
+	DEBUG_Print("\r\n");
+	switch (edited) {
+		case MENU_LOOP_BUDGET:
+			if (entered && menu_number != 0) {
+				LoopMonitor_SetBudget(menu_number);
+				DEBUG_Print("Loop budget set to ");
+				DEBUG_PrintNumber(menu_number, 10);
+				DEBUG_Print(" us\r\n");
+			} else {
+				DEBUG_Print(INVALID_LOOP_BUDGET_MESSAGE);
+			}
+			break;
+		case MENU_VCU_HEARTBEAT_PERIOD:
+			if (entered && menu_number <= UINT16_MAX) {
+				vcu_heartbeat_period_ms = menu_number;
+				DEBUG_Print("VCU heartbeat period set to ");
+				DEBUG_PrintNumber(menu_number, 10);
+				DEBUG_Print(" ms\r\n");
+			} else {
+				DEBUG_Print(INVALID_VCU_HEARTBEAT_PERIOD_MESSAGE);
+			}
+			break;
+		case MENU_BMS_RESPONSE_LATENCY:
+			if (entered && menu_number <= UINT16_MAX) {
+				BmsEmulator_SetResponseLatency(menu_number);
+				DEBUG_Print("Discharge response latency set to ");
+				DEBUG_PrintNumber(menu_number, 10);
+				DEBUG_Print(" ms\r\n");
+			} else {
+				DEBUG_Print(INVALID_BMS_RESPONSE_LATENCY_MESSAGE);
+			}
+			break;
+		case MENU_TELEMETRY_PERIOD:
+			if (entered && menu_number <= UINT16_MAX) {
+				Telemetry_SetPeriod(menu_telemetry_signal, menu_number);
+				DEBUG_Print("Telemetry period set to ");
+				DEBUG_PrintNumber(menu_number, 10);
+				DEBUG_Print(" ms\r\n");
+			} else {
+				DEBUG_Print(INVALID_TELEMETRY_PERIOD_MESSAGE);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * @details copies the current runtime settings into a configuration record
+ *
+ * @param config datatype that is mutated to hold the current settings
+ */
+static void Capture_Config(TESTER_CONFIG_T * config) {
+	uint8_t i;
+
+	memset(config, 0, sizeof(TESTER_CONFIG_T));
+	config->vcu_state = VCU_STATE_T;
+	config->idle_enabled = Idle_IsEnabled();
+	config->vcu_heartbeat_period_ms = vcu_heartbeat_period_ms;
+	config->loop_budget_us = LoopMonitor_GetBudget();
+	for (i = 0; i < TELEMETRY_SIGNAL_COUNT; i++) {
+		config->telemetry_period_ms[i] = Telemetry_GetPeriod(i);
+	}
+	Dispatch_GetFilter(&config->filter_id, &config->filter_mask);
+	config->gateway_at_boot = gateway_at_boot;
+	config->can_bitrate = CanBus_GetBitrate();
+	config->can_listen_only = CanBus_IsListenOnly();
+}
+
+/**
+ * @details applies a configuration record to the runtime settings, except
+ * the CAN bit rate and listen-only mode: those are only read at boot, where
+ * they are passed to CanBus_Init
+ *
+ * @param config configuration to apply
+ */
+static void Apply_Config(const TESTER_CONFIG_T * config) {
+	uint8_t i;
+
+	VCU_STATE_T = config->vcu_state <= NONE ? config->vcu_state : STANDBY;
+	Idle_SetEnabled(config->idle_enabled);
+	vcu_heartbeat_period_ms = config->vcu_heartbeat_period_ms;
+	LoopMonitor_SetBudget(config->loop_budget_us);
+	for (i = 0; i < TELEMETRY_SIGNAL_COUNT; i++) {
+		Telemetry_SetPeriod(i, config->telemetry_period_ms[i]);
+	}
+	Dispatch_SetFilter(config->filter_id, config->filter_mask);
+	gateway_at_boot = config->gateway_at_boot;
+}
+
+/**
+ * @details handles the rate entered after 'B'. The acknowledgement is sent
+ * at the old rate, then the UART switches and waits for the host to confirm
+ * at the new rate, reverting if no confirmation arrives in time.
+ *
+ * @param key key received over UART
+ */
+static void Process_Baud_Select_Menu(uint8_t key) {
+	uint32_t requested;
+	uint32_t actual;
+	uint32_t error;
+
+	menu_state = MENU_TOP;
+	switch (key) {
+		case '1':
+			requested = 115200;
+			break;
+		case '2':
+			requested = 230400;
+			break;
+		case '4':
+			requested = 460800;
+			break;
+		case '9':
+			requested = 921600;
+			break;
+		default:
+			DEBUG_Print(UNRECOGNIZED_BAUD_MESSAGE);
+			return;
+	}
+
+	DEBUG_Print("BAUD ");
+	DEBUG_PrintNumber(requested, 10);
+	DEBUG_Print("\r\n");
+
+	previous_baudrate = Serial_GetBaud();
+	actual = Serial_SetBaud(requested);
+	error = actual > requested ? actual - requested : requested - actual;
+	if (error * 100 > requested * BAUD_MAX_ERROR_PERCENT) {
+		Serial_SetBaud(previous_baudrate);
+		DEBUG_Print("ERR baud error too large\r\n");
+		return;
+	}
+
+	baud_change_time = msTicks;
+	menu_state = MENU_BAUD_CONFIRM;
+}
+
+/**
+ * @details waits for the host to confirm a baud change at the new rate
+ *
+ * @param key key received over UART
+ */
+static void Process_Baud_Confirm_Menu(uint8_t key) {
+	if (key != BAUD_CONFIRM_KEY) {
+		return;
+	}
+
+	menu_state = MENU_TOP;
+	DEBUG_Print("\r\nOK ");
+	DEBUG_PrintNumber(Serial_GetBaud(), 10);
+	DEBUG_Print("\r\n");
+}
+
+/**
+ * @details streams part of the throughput test pattern, as much as fits in
+ * the transmit buffer without blocking
+ *
+ * @return true if test output was queued
+ */
+static bool Process_Throughput_Test(void) {
+	static const char pattern[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ\r\n";
+	const uint32_t pattern_length = sizeof(pattern) - 1;
+	uint32_t space;
+
+	if (throughput_remaining == 0) {
+		return false;
+	}
+
+	space = Serial_TxSpace();
+	while (space > 0 && throughput_remaining > 0) {
+		uint32_t offset = (THROUGHPUT_TEST_BYTES - throughput_remaining) % pattern_length;
+		uint32_t chunk = pattern_length - offset;
+		if (chunk > space) {
+			chunk = space;
+		}
+		if (chunk > throughput_remaining) {
+			chunk = throughput_remaining;
+		}
+		DEBUG_Write(&pattern[offset], chunk);
+		space -= chunk;
+		throughput_remaining -= chunk;
+	}
+
+	if (throughput_remaining == 0) {
+		DEBUG_Print("END ");
+		DEBUG_PrintNumber(msTicks - throughput_start_time, 10);
+		DEBUG_Print(" ms\r\n");
+	}
+	return true;
+}
+
+/**
+ * @details parses hex digits up to the first non hex character
+ *
+ * @param text text to parse
+ * @param value mutated to hold the parsed value
+ * @return number of digits parsed
+ */
+static uint8_t parse_hex(const char * text, uint32_t * value) {
+	uint8_t digits = 0;
+
+	*value = 0;
+	while (true) {
+		char c = text[digits];
+		uint8_t nibble;
+		if (c >= '0' && c <= '9') {
+			nibble = c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			nibble = c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			nibble = c - 'A' + 10;
+		} else {
+			return digits;
+		}
+		*value = (*value << 4) | nibble;
+		digits++;
+	}
+}
+
+/**
+ * @details parses a CAN id in candump notation: up to 3 hex digits for a
+ * standard id, more digits for an extended id
+ *
+ * @param text text to parse
+ * @param mode_id mutated to hold the id, or'ed with CAN_MSGOBJ_EXT if extended
+ * @return number of characters parsed, 0 if the id is invalid
+ */
+static uint8_t parse_can_id(const char * text, uint32_t * mode_id) {
+	const uint8_t max_std_digits = 3;
+	const uint8_t max_ext_digits = 8;
+	uint8_t digits = parse_hex(text, mode_id);
+
+	if (digits == 0 || digits > max_ext_digits) {
+		return 0;
+	}
+	if (digits > max_std_digits || *mode_id > CAN_BUS_MAX_STD_ID) {
+		if (*mode_id > CAN_BUS_MAX_EXT_ID) {
+			return 0;
+		}
+		*mode_id |= CAN_MSGOBJ_EXT;
+	}
+	return digits;
+}
+
+/**
+ * @details sends a frame typed as <id>#<data>
+ *
+ * @param line text entered by the user
+ * @return false if the frame could not be parsed
+ */
+static bool Send_Raw_Frame(const char * line) {
+	const uint8_t max_dlc = 8;
+	uint8_t data[8];
+	uint8_t dlc = 0;
+	uint32_t mode_id;
+	uint32_t value;
+	uint8_t pos = parse_can_id(line, &mode_id);
+
+	if (pos == 0 || line[pos] != '#') {
+		return false;
+	}
+	pos++;
+
+	while (line[pos] != '\0') {
+		const char byte_text[3] = {line[pos], line[pos + 1], '\0'};
+		if (dlc == max_dlc || parse_hex(byte_text, &value) != 2) {
+			return false;
+		}
+		data[dlc++] = value;
+		pos += 2;
+	}
+
+	if (!Fault_Transmit(mode_id, data, dlc)) {
+		print_transmit_failure();
+		return true;
+	}
+	DEBUG_Print("Sent ");
+	DEBUG_Print(line);
+	DEBUG_Print("\r\n");
+	return true;
+}
+
+/**
+ * @details sets the acceptance filter typed as <id>:<mask>, an empty line
+ * clears it
+ *
+ * @param line text entered by the user
+ * @return false if the filter could not be parsed
+ */
+static bool Set_Filter(const char * line) {
+	uint32_t mode_id;
+	uint32_t mask;
+	uint8_t pos;
+	uint8_t mask_digits;
+
+	if (line[0] == '\0') {
+		Dispatch_SetFilter(0, 0);
+		DEBUG_Print("Accepting all messages\r\n");
+		return true;
+	}
+
+	pos = parse_can_id(line, &mode_id);
+	if (pos == 0 || line[pos] != ':') {
+		return false;
+	}
+	pos++;
+	mask_digits = parse_hex(&line[pos], &mask);
+	if (mask_digits == 0 || mask_digits > 8 || line[pos + mask_digits] != '\0') {
+		return false;
+	}
+
+	// always compare the extended flag, a standard filter never matches 29 bit ids
+	Dispatch_SetFilter(mode_id, mask | CAN_MSGOBJ_EXT);
+	DEBUG_Print("Filter set\r\n");
+	return true;
+}
+
+/**
+ * @details parses a decimal number after skipping leading spaces
+ *
+ * @param text text to parse
+ * @param value mutated to hold the parsed value
+ * @return number of characters parsed including the spaces, 0 if there is no
+ * number or it doesn't fit in 32 bits
+ */
+static uint8_t parse_decimal(const char * text, uint32_t * value) {
+	uint8_t pos = 0;
+	uint8_t digits = 0;
+
+	while (text[pos] == ' ') {
+		pos++;
+	}
+	*value = 0;
+	while (text[pos] >= '0' && text[pos] <= '9') {
+		if (*value > (UINT32_MAX - (text[pos] - '0')) / 10) {
+			return 0;
 		}
+		*value = *value * 10 + (text[pos] - '0');
+		pos++;
+		digits++;
+	}
+	return digits == 0 ? 0 : pos;
+}
+
+/**
+ * @details sets an emulated BMS signal trajectory typed as
+ * <signal> <shape> <from> <to> <period ms>
+ *
+ * @param line text entered by the user
+ * @return false if the trajectory could not be parsed
+ */
+static bool Set_BMS_Trajectory(const char * line) {
+	static const char shapes[] = "crts";
+	BMS_EMULATOR_TRAJECTORY_T trajectory;
+	uint32_t signal;
+	uint32_t from;
+	uint32_t to;
+	uint32_t period_ms;
+	const char * shape;
+	uint8_t pos;
+	uint8_t parsed;
+
+	pos = parse_decimal(line, &signal);
+	if (pos == 0 || signal >= BMS_EMULATOR_SIGNAL_COUNT || line[pos] != ' ') {
+		return false;
+	}
+	while (line[pos] == ' ') {
+		pos++;
+	}
+	shape = strchr(shapes, line[pos]);
+	if (line[pos] == '\0' || shape == NULL) {
+		return false;
+	}
+	pos++;
+	if ((parsed = parse_decimal(&line[pos], &from)) == 0 || from > UINT16_MAX) {
+		return false;
+	}
+	pos += parsed;
+	if ((parsed = parse_decimal(&line[pos], &to)) == 0 || to > UINT16_MAX) {
+		return false;
+	}
+	pos += parsed;
+	if ((parsed = parse_decimal(&line[pos], &period_ms)) == 0 || line[pos + parsed] != '\0') {
+		return false;
+	}
+
+	trajectory.shape = shape - shapes;
+	trajectory.from = from;
+	trajectory.to = to;
+	trajectory.period_ms = period_ms;
+	BmsEmulator_SetTrajectory(signal, &trajectory);
+	DEBUG_Print("Trajectory set\r\n");
+	return true;
+}
+
+/**
+ * @details parses a fault pattern typed as binary digits, the first digit
+ * standing for the first frame of each repetition
+ *
+ * @param text text to parse
+ * @param pattern mutated to hold the pattern, bit 0 for the first frame
+ * @return number of digits parsed, 0 if there are none or too many
+ */
+static uint8_t parse_pattern(const char * text, uint32_t * pattern) {
+	uint8_t digits = 0;
+
+	*pattern = 0;
+	while (text[digits] == '0' || text[digits] == '1') {
+		if (digits == FAULT_MAX_PATTERN_LENGTH) {
+			return 0;
+		}
+		if (text[digits] == '1') {
+			*pattern |= 1UL << digits;
+		}
+		digits++;
+	}
+	return digits;
+}
+
+/**
+ * @details sets a fault rule typed as
+ * <id> <action> <p<percent>|b<pattern>> [<delay ms>|<start> <end> <value>].
+ * <id> n removes the rule for an id, s <seed> reseeds the PRNG and an empty
+ * line removes all rules.
+ *
+ * @param line text entered by the user
+ * @return false if the rule could not be parsed or there is no room for it
+ */
+static bool Set_Fault_Rule(const char * line) {
+	// indexed by FAULT_ACTION_T
+	static const char actions[] = "ndluoc";
+	FAULT_RULE_T rule;
+	uint32_t start;
+	uint32_t end;
+	uint32_t value;
+	const char * action;
+	uint8_t pos;
+	uint8_t parsed;
+
+	if (line[0] == '\0') {
+		Fault_ClearRules();
+		DEBUG_Print("Fault rules removed\r\n");
+		return true;
+	}
+	if (line[0] == 's') {
+		if ((parsed = parse_decimal(&line[1], &value)) == 0 || line[1 + parsed] != '\0') {
+			return false;
+		}
+		Fault_Seed(value);
+		DEBUG_Print("Fault PRNG seeded\r\n");
+		return true;
+	}
+
+	memset(&rule, 0, sizeof(rule));
+	pos = parse_can_id(line, &rule.mode_id);
+	if (pos == 0 || line[pos] != ' ') {
+		return false;
+	}
+	while (line[pos] == ' ') {
+		pos++;
+	}
+	action = strchr(actions, line[pos]);
+	if (line[pos] == '\0' || action == NULL) {
+		return false;
+	}
+	rule.action = action - actions;
+	pos++;
+
+	if (rule.action != FAULT_NONE) {
+		while (line[pos] == ' ') {
+			pos++;
+		}
+		if (line[pos] == 'p') {
+			if ((parsed = parse_decimal(&line[pos + 1], &value)) == 0 || value > 100) {
+				return false;
+			}
+			rule.probability = value;
+		} else if (line[pos] == 'b') {
+			if ((parsed = parse_pattern(&line[pos + 1], &rule.pattern)) == 0) {
+				return false;
+			}
+			rule.pattern_length = parsed;
+		} else {
+			return false;
+		}
+		pos += 1 + parsed;
+	}
+
+	if (rule.action == FAULT_DELAY) {
+		if ((parsed = parse_decimal(&line[pos], &value)) == 0 || value > UINT16_MAX) {
+			return false;
+		}
+		rule.delay_ms = value;
+		pos += parsed;
+	} else if (rule.action == FAULT_CORRUPT) {
+		if ((parsed = parse_decimal(&line[pos], &start)) == 0 || start > UINT8_MAX) {
+			return false;
+		}
+		pos += parsed;
+		if ((parsed = parse_decimal(&line[pos], &end)) == 0 || end > UINT8_MAX) {
+			return false;
+		}
+		pos += parsed;
+		if ((parsed = parse_decimal(&line[pos], &value)) == 0) {
+			return false;
+		}
+		pos += parsed;
+		rule.signal_start = start;
+		rule.signal_end = end;
+		rule.signal_value = value;
+	}
+
+	if (line[pos] != '\0' || !Fault_SetRule(&rule)) {
+		return false;
+	}
+	DEBUG_Print(rule.action == FAULT_NONE ? "Fault rule removed\r\n" : "Fault rule set\r\n");
+	return true;
+}
+
+/**
+ * @details collects a line of text and applies it to the menu being edited
+ * once enter is pressed
+ *
+ * @param key key received over UART
+ */
+static void Process_Line_Menu(uint8_t key) {
+	const uint8_t backspace = 0x08;
+	const uint8_t delete = 0x7F;
+	enum MENU_STATE edited = menu_state;
+
+	if (key == backspace || key == delete) {
+		if (menu_line_length > 0) {
+			menu_line_length--;
+		}
+		return;
+	}
+	if (key != '\r' && key != '\n') {
+		if (menu_line_length < MENU_LINE_SIZE - 1) {
+			menu_line[menu_line_length++] = key;
+		}
+		return;
+	}
+
+	menu_line[menu_line_length] = '\0';
+	menu_state = MENU_TOP;
+	DEBUG_Print("\r\n");
+	switch (edited) {
+		case MENU_SEND_RAW_FRAME:
+			if (!Send_Raw_Frame(menu_line)) {
+				DEBUG_Print(INVALID_FRAME_MESSAGE);
+			}
+			break;
+		case MENU_SET_FILTER:
+			if (!Set_Filter(menu_line)) {
+				DEBUG_Print(INVALID_FILTER_MESSAGE);
+			}
+			break;
+		case MENU_BMS_TRAJECTORY:
+			if (!Set_BMS_Trajectory(menu_line)) {
+				DEBUG_Print(INVALID_BMS_TRAJECTORY_MESSAGE);
+			}
+			break;
+		case MENU_FAULT_RULE:
+			if (!Set_Fault_Rule(menu_line)) {
+				DEBUG_Print(INVALID_FAULT_RULE_MESSAGE);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * @details feeds a byte of an uploaded script. A rejected upload keeps
+ * swallowing bytes until the host stops sending, so the rest of the script
+ * isn't taken for command keys.
+ *
+ * @param byte byte received over UART
+ */
+static void Process_Script_Upload(uint8_t byte) {
+	script_upload_time = msTicks;
+	if (script_upload_rejected) {
+		return;
+	}
+	switch (Script_LoadByte(byte)) {
+		case SCRIPT_LOAD_DONE:
+			menu_state = MENU_TOP;
+			DEBUG_Print("Script loaded\r\n");
+			break;
+		case SCRIPT_LOAD_ERROR:
+			script_upload_rejected = true;
+			DEBUG_Print("Invalid script\r\n");
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * @details handles the key entered after 'c'
+ *
+ * @param key key received over UART
+ */
+static void Process_CAN_Bitrate_Menu(uint8_t key) {
+	uint32_t bitrate;
+
+	menu_state = MENU_TOP;
+	switch (key) {
+		case '1':
+			bitrate = 125000;
+			break;
+		case '2':
+			bitrate = 250000;
+			break;
+		case '5':
+			bitrate = 500000;
+			break;
+		case 'M':
+			bitrate = 1000000;
+			break;
+		case 'a':
+			CanBus_StartAutoBaud();
+			detecting_can_bitrate = true;
+			DEBUG_Print("Detecting the CAN bit rate, listening only\r\n");
+			return;
+		default:
+			DEBUG_Print(UNRECOGNIZED_CAN_BITRATE_MESSAGE);
+			return;
+	}
+
+	CanBus_Configure(bitrate, CanBus_IsListenOnly());
+	DEBUG_Print("CAN at ");
+	DEBUG_PrintNumber(bitrate, 10);
+	DEBUG_Print(" bit/s\r\n");
+}
+
+/**
+ * @details handles a top level command key
+ *
+ * @param key key received over UART
+ */
+static void Process_Command(uint8_t key) {
+	switch (key) {
+		case CONFIGURE_VCU_HEARTBEAT:
+			DEBUG_Print(CONFIGURE_VCU_HEARTBEAT_HELP_MESSAGE);
+			menu_state = MENU_VCU_HEARTBEAT;
+			break;
+		case SET_VCU_HEARTBEAT_PERIOD:
+			DEBUG_Print(SET_VCU_HEARTBEAT_PERIOD_HELP_MESSAGE);
+			menu_number = 0;
+			menu_state = MENU_VCU_HEARTBEAT_PERIOD;
+			break;
+		case SEND_DISCHARGE_REQUEST:
+			; //empty statement
+			uint8_t discharge_request_bit_position = 7;
+			uint8_t data = ____VCU_DISCHARGE_REQUEST__DISCHARGE_REQUEST__ENTER_DISCHARGE << discharge_request_bit_position;
+			uint8_t length = 1;
+			if (Fault_Transmit(VCU_DISCHARGE_REQUEST__id, &data, length)) {
+				DEBUG_Print("Sent discharge request\r\n");
+			} else {
+				print_transmit_failure();
+			}
+			break;
+		case PRINT_PROFILE:
+			Profile_Dump();
+			break;
+		case PRINT_LOOP_STATS:
+			LoopMonitor_Dump();
+			Idle_Dump();
+			BmsEmulator_Dump();
+			break;
+		case PRINT_MEMORY:
+			Arena_Dump();
+			break;
+		case PRINT_TX_QUEUE:
+			CanBus_Dump();
+			Fault_Dump();
+			break;
+		case SET_CAN_BITRATE:
+			if (detecting_can_bitrate) {
+				DEBUG_Print(DETECTING_CAN_BITRATE_MESSAGE);
+				break;
+			}
+			DEBUG_Print("CAN at ");
+			DEBUG_PrintNumber(CanBus_GetBitrate(), 10);
+			DEBUG_Print(CanBus_IsListenOnly() ? " bit/s, listening only\r\n" : " bit/s\r\n");
+			DEBUG_Print(SET_CAN_BITRATE_HELP_MESSAGE);
+			menu_state = MENU_CAN_BITRATE;
+			break;
+		case TOGGLE_LISTEN_ONLY:
+			if (detecting_can_bitrate) {
+				DEBUG_Print(DETECTING_CAN_BITRATE_MESSAGE);
+				break;
+			}
+			CanBus_Configure(CanBus_GetBitrate(), !CanBus_IsListenOnly());
+			DEBUG_Print(CanBus_IsListenOnly() ? "Listening only, nothing is sent or acknowledged\r\n" : "Sending and acknowledging frames\r\n");
+			break;
+		case SET_FAULT_RULE:
+			DEBUG_Print(SET_FAULT_RULE_HELP_MESSAGE);
+			menu_line_length = 0;
+			menu_state = MENU_FAULT_RULE;
+			break;
+		case UPLOAD_SCRIPT:
+			DEBUG_Print(UPLOAD_SCRIPT_HELP_MESSAGE);
+			Script_BeginLoad();
+			script_upload_time = msTicks;
+			script_upload_rejected = false;
+			menu_state = MENU_SCRIPT_UPLOAD;
+			break;
+		case RUN_SCRIPT:
+			if (Script_IsRunning()) {
+				Script_Abort();
+			} else if (Script_Start()) {
+				DEBUG_Print("Running script\r\n");
+			} else {
+				DEBUG_Print("No script loaded\r\n");
+			}
+			break;
+		case SET_LOOP_BUDGET:
+			DEBUG_Print(SET_LOOP_BUDGET_HELP_MESSAGE);
+			menu_number = 0;
+			menu_state = MENU_LOOP_BUDGET;
+			break;
+		case CONFIGURE_TELEMETRY:
+			Telemetry_PrintSignals();
+			DEBUG_Print(CONFIGURE_TELEMETRY_HELP_MESSAGE);
+			menu_state = MENU_TELEMETRY_SIGNAL;
+			break;
+		case NEGOTIATE_BAUD:
+			DEBUG_Print(NEGOTIATE_BAUD_HELP_MESSAGE);
+			menu_state = MENU_BAUD_SELECT;
+			break;
+		case THROUGHPUT_TEST:
+			DEBUG_Print("START ");
+			DEBUG_PrintNumber(THROUGHPUT_TEST_BYTES, 10);
+			DEBUG_Print("\r\n");
+			throughput_remaining = THROUGHPUT_TEST_BYTES;
+			throughput_start_time = msTicks;
+			break;
+		case SAVE_CONFIG:
+			if (detecting_can_bitrate) {
+				DEBUG_Print(DETECTING_CAN_BITRATE_MESSAGE);
+				break;
+			}
+			Capture_Config(&tester_config);
+			DEBUG_Print(Config_Save(&tester_config) ? "Configuration saved\r\n" : "Failed to save configuration\r\n");
+			break;
+		case ERASE_CONFIG:
+			DEBUG_Print(Config_Erase() ? "Configuration erased, defaults apply after reset\r\n" : "Failed to erase configuration\r\n");
+			break;
+		case SEND_RAW_FRAME:
+			DEBUG_Print(SEND_RAW_FRAME_HELP_MESSAGE);
+			menu_line_length = 0;
+			menu_state = MENU_SEND_RAW_FRAME;
+			break;
+		case SET_FILTER:
+			DEBUG_Print(SET_FILTER_HELP_MESSAGE);
+			menu_line_length = 0;
+			menu_state = MENU_SET_FILTER;
+			break;
+		case ENTER_GATEWAY:
+			if (detecting_can_bitrate) {
+				DEBUG_Print(DETECTING_CAN_BITRATE_MESSAGE);
+				break;
+			}
+			DEBUG_Print(ENTER_GATEWAY_MESSAGE);
+			Slcan_SetActive(true);
+			break;
+		case TOGGLE_GATEWAY_AT_BOOT:
+			gateway_at_boot = !gateway_at_boot;
+			DEBUG_Print(gateway_at_boot ? "Starting in gateway mode after reset, enter 'W' to keep it\r\n" : "Starting in this menu after reset\r\n");
+			break;
+		case TOGGLE_BMS_EMULATOR:
+			BmsEmulator_SetActive(!BmsEmulator_IsActive());
+			DEBUG_Print(BmsEmulator_IsActive() ? "Emulating the BMS, VCU heartbeats paused\r\n" : "Stopped emulating the BMS\r\n");
+			break;
+		case SET_BMS_RESPONSE_LATENCY:
+			DEBUG_Print(SET_BMS_RESPONSE_LATENCY_HELP_MESSAGE);
+			menu_number = 0;
+			menu_state = MENU_BMS_RESPONSE_LATENCY;
+			break;
+		case SET_BMS_TRAJECTORY:
+			DEBUG_Print(SET_BMS_TRAJECTORY_HELP_MESSAGE);
+			menu_line_length = 0;
+			menu_state = MENU_BMS_TRAJECTORY;
+			break;
+		case TOGGLE_IDLE:
+			Idle_SetEnabled(!Idle_IsEnabled());
+			DEBUG_Print(Idle_IsEnabled() ? "Sleeping between events\r\n" : "Busy polling\r\n");
+			break;
+		case HELP:
+			DEBUG_Print("Enter 'v' to configure VCU heartbeat. Enter 'H' to set its period. Enter 'd' to send discharge request.\r\n");
+			DEBUG_Print("Enter 'p' to print the profile table.\r\n");
+			DEBUG_Print("Enter 'l' to print main loop latency. Enter 'b' to set the loop budget.\r\n");
+			DEBUG_Print("Enter 'i' to toggle sleeping between events.\r\n");
+			DEBUG_Print("Enter 'r' to set the output rate of a telemetry signal.\r\n");
+			DEBUG_Print("Enter 'B' to change the baud rate. Enter 'x' to run a throughput test.\r\n");
+			DEBUG_Print("Enter 'W' to save the configuration to flash. Enter 'E' to erase it.\r\n");
+			DEBUG_Print("Enter 'T' to send a standard or extended frame. Enter 'F' to filter received messages.\r\n");
+			DEBUG_Print("Enter 'G' to act as an SLCAN adapter. Enter 'g' to toggle starting as one.\r\n");
+			DEBUG_Print("Enter 'e' to toggle emulating the BMS. Enter 'y' to set its discharge response latency.\r\n");
+			DEBUG_Print("Enter 'j' to script an emulated BMS signal.\r\n");
+			DEBUG_Print("Enter 'm' to print buffer and stack high-water marks. Enter 'q' to print transmit queue statistics.\r\n");
+			DEBUG_Print("Enter 'S' to upload a test script. Enter 'R' to run or abort it.\r\n");
+			DEBUG_Print("Enter 'c' to set or detect the CAN bit rate. Enter 'L' to toggle listening only.\r\n");
+			DEBUG_Print("Enter 'f' to inject faults into transmitted frames, 'q' shows them with the detection time.\r\n");
+			break;
+		default:
+			DEBUG_Print("unrecognized key\r\n");
+			break;
 	}
 }
 
 /**
  * Transmits CAN messages
+ *
+ * @return true if a key was received or a CAN message was sent
  */
-void Process_CAN_Outputs(void) {
+bool Process_CAN_Outputs(void) {
 	// TODO
 	// read UART
 	// if something in the buffer
@@ -228,62 +1402,91 @@ void Process_CAN_Outputs(void) {
 
 	// send bms heartbeat every second
 
+	bool busy = false;
 	uint8_t count;
-	count = Chip_UART_Read(LPC_USART, uart_rx_buf, UART_RX_BUFFER_SIZE);
+	count = Serial_Read(uart_rx_buf, UART_RX_BUFFER_SIZE);
 	if (count != 0) {
-		Chip_UART_SendBlocking(LPC_USART, uart_rx_buf, count);
-		DEBUG_Print("\r\n");
-		switch (uart_rx_buf[0]) {
-			case CONFIGURE_VCU_HEARTBEAT:
-				DEBUG_Print(CONFIGURE_VCU_HEARTBEAT_HELP_MESSAGE);
-				count = Chip_UART_ReadBlocking(LPC_USART, uart_rx_buf, UART_RX_BUFFER_SIZE);
-				Chip_UART_SendBlocking(LPC_USART, uart_rx_buf, count);
+		Idle_MarkDispatch(Serial_LastRxCycles());
+		busy = true;
+		if (menu_state != MENU_SCRIPT_UPLOAD) {
+			DEBUG_Write(uart_rx_buf, count);
+		}
+		switch (menu_state) {
+			case MENU_VCU_HEARTBEAT:
 				DEBUG_Print("\r\n");
-				switch (uart_rx_buf[0]) {
-					case SEND_STANDBY_VCU_HEARTBEAT:
-						VCU_STATE_T = STANDBY;
-						DEBUG_Print(SEND_VCU_HEARTBEAT_STANDBY_MESSAGE);
-						break;
-					case SEND_DISCHARGE_VCU_HEARTBEAT:
-						VCU_STATE_T = DISCHARGE;
-						DEBUG_Print(SEND_VCU_HEARTBEAT_DISCHARGE_MESSAGE);
-						break;
-					case DONT_SEND_VCU_HEARTBEAT:
-						VCU_STATE_T = NONE;
-						DEBUG_Print(DONT_SEND_VCU_HEARTBEAT_MESSAGE);
-						break;
-					default:
-						DEBUG_Print(UNRECOGNIZED_STATE_CONFIGURE_VCU_HEARTBEAT_MESSAGE);
-						break;
-				}
+				Process_VCU_Heartbeat_Menu(uart_rx_buf[0]);
 				break;
-			case SEND_DISCHARGE_REQUEST:
-				; //empty statement
-				uint8_t discharge_request_bit_position = 7;
-				uint8_t data = ____VCU_DISCHARGE_REQUEST__DISCHARGE_REQUEST__ENTER_DISCHARGE << discharge_request_bit_position;
-				uint8_t length = 1;
-				CAN_Transmit(VCU_DISCHARGE_REQUEST__id, &data, length);
-				DEBUG_Print("Sent discharge request\r\n");
+			case MENU_TELEMETRY_SIGNAL:
+				DEBUG_Print("\r\n");
+				Process_Telemetry_Signal_Menu(uart_rx_buf[0]);
+				break;
+			case MENU_VCU_HEARTBEAT_PERIOD:
+			case MENU_LOOP_BUDGET:
+			case MENU_TELEMETRY_PERIOD:
+			case MENU_BMS_RESPONSE_LATENCY:
+				Process_Number_Menu(uart_rx_buf[0]);
 				break;
-			case HELP:
-				DEBUG_Print("Enter 'v' to configure VCU heartbeat. Enter 'd' to send discharge request.\r\n");
+			case MENU_BAUD_SELECT:
+				DEBUG_Print("\r\n");
+				Process_Baud_Select_Menu(uart_rx_buf[0]);
+				break;
+			case MENU_BAUD_CONFIRM:
+				Process_Baud_Confirm_Menu(uart_rx_buf[0]);
+				break;
+			case MENU_CAN_BITRATE:
+				DEBUG_Print("\r\n");
+				Process_CAN_Bitrate_Menu(uart_rx_buf[0]);
+				break;
+			case MENU_SEND_RAW_FRAME:
+			case MENU_SET_FILTER:
+			case MENU_BMS_TRAJECTORY:
+			case MENU_FAULT_RULE:
+				Process_Line_Menu(uart_rx_buf[0]);
+				break;
+			case MENU_SCRIPT_UPLOAD:
+				Process_Script_Upload(uart_rx_buf[0]);
 				break;
 			default:
-				DEBUG_Print("unrecognized key\r\n");
+				DEBUG_Print("\r\n");
+				Process_Command(uart_rx_buf[0]);
 				break;
 		}
 	}
 
-	//Send BMS heartbeat every second
-	const uint16_t one_second = 1000;
-	if (msTicks - last_bms_heartbeat_time > one_second) {
+	if (menu_state == MENU_BAUD_CONFIRM && msTicks - baud_change_time > BAUD_CONFIRM_TIMEOUT_MS) {
+		Serial_SetBaud(previous_baudrate);
+		menu_state = MENU_TOP;
+		DEBUG_Print("Baud change not confirmed, reverted to ");
+		DEBUG_PrintNumber(previous_baudrate, 10);
+		DEBUG_Print("\r\n");
+	}
+
+	if (menu_state == MENU_SCRIPT_UPLOAD && msTicks - script_upload_time > SCRIPT_UPLOAD_TIMEOUT_MS) {
+		menu_state = MENU_TOP;
+		if (!script_upload_rejected) {
+			DEBUG_Print("Script upload timed out\r\n");
+		}
+	}
+
+	busy |= Process_Throughput_Test();
+
+	//Send BMS heartbeat every period, the VCU under test sends its own while the BMS is emulated
+	if (!BmsEmulator_IsActive() && !CanBus_IsListenOnly() && vcu_heartbeat_period_ms != 0 && msTicks - last_bms_heartbeat_time > vcu_heartbeat_period_ms) {
 		sendBMSHeartbeat();
 		last_bms_heartbeat_time = msTicks;
+		busy = true;
 	}
+
+	busy |= BmsEmulator_Update();
+	busy |= Script_Update();
+	busy |= Fault_Update();
+
+	return busy;
 }
 
 int main(void) {
 
+	Arena_Init();
 	SystemCoreClockUpdate();
 
 	uint32_t reset_can_peripheral_time;
@@ -295,22 +1498,43 @@ int main(void) {
 		while(1);
 	}
 
-	Chip_IOCON_PinMuxSet(LPC_IOCON, IOCON_PIO1_6, (IOCON_FUNC1 | IOCON_MODE_INACT)); /* RXD */
-	Chip_IOCON_PinMuxSet(LPC_IOCON, IOCON_PIO1_7, (IOCON_FUNC1 | IOCON_MODE_INACT)); /* TXD */
-	
-	Chip_UART_Init(LPC_USART);
-	Chip_UART_SetBaud(LPC_USART, BAUDRATE);
-	// Configure data width, parity, and stop bits
-	Chip_UART_ConfigData(LPC_USART, (UART_LCR_WLEN8 | UART_LCR_SBS_1BIT | UART_LCR_PARITY_DIS));
-	Chip_UART_SetupFIFOS(LPC_USART, (UART_FCR_FIFO_EN | UART_FCR_TRG_LEV2));
-	Chip_UART_TXEnable(LPC_USART);
+	Serial_Init(BAUDRATE);
 
 	DEBUG_Print("Started up\n\r");
 	DEBUG_Print("Enter 'h' for help\r\n");
 
-	CAN_Init(500000);
+	Profile_Init();
+	LoopMonitor_Init(LOOP_MONITOR_DEFAULT_BUDGET_US);
+	Idle_Init(true);
+	Telemetry_Init();
+	Register_CAN_Handlers();
+	Slcan_Init();
+	BmsEmulator_Init();
+	Script_Init();
+	Fault_Init();
+	SignalDb_Init();
+
+	// CAN starts once, with the saved settings
+	Capture_Config(&tester_config);
+	tester_config.can_bitrate = CAN_BUS_DEFAULT_BITRATE;
+	tester_config.can_listen_only = false;
+	if (Config_Load(&tester_config)) {
+		Apply_Config(&tester_config);
+		DEBUG_Print("Loaded saved configuration\r\n");
+	}
+	if (!CanBus_IsStandardBitrate(tester_config.can_bitrate)) {
+		tester_config.can_bitrate = CAN_BUS_DEFAULT_BITRATE;
+	}
+	CanBus_Init(tester_config.can_bitrate, tester_config.can_listen_only);
+
+	if (gateway_at_boot) {
+		DEBUG_Print(ENTER_GATEWAY_MESSAGE);
+		Slcan_SetActive(true);
+	}
 	
 	while (1) {
+		LoopMonitor_Tick();
+
 		//read can message
 			//switch (message ID)
 				//switch (message)
@@ -322,14 +1546,30 @@ int main(void) {
 
        		 if(reset_can_peripheral && msTicks > reset_can_peripheral_time) {
             		DEBUG_Print("Attempting to reset CAN peripheral...\r\n ");
-            		CAN_ResetPeripheral();
-            		CAN_Init(500000);
+            		CanBus_Reset();
             		DEBUG_Print("Reset CAN peripheral. \r\n ");
             		reset_can_peripheral = false;
         	}
 
-		Process_CAN_Inputs();
-		Process_CAN_Outputs();
+		bool busy;
+		if (Slcan_IsActive()) {
+			// the UART belongs to the gateway, nothing else may print
+			busy = Slcan_Process();
+			if (!Slcan_IsActive()) {
+				DEBUG_Print("\r\nLeft SLCAN gateway mode\r\n");
+			}
+		} else {
+			PROFILE_Enter(PROFILE_PROCESS_CAN_INPUTS);
+			busy = Process_CAN_Inputs();
+			PROFILE_Exit(PROFILE_PROCESS_CAN_INPUTS);
+			busy |= Process_CAN_Outputs();
+			Telemetry_Update();
+			LoopMonitor_Report();
+		}
+
+		if (!busy) {
+			LoopMonitor_Slept(Idle_Sleep());
+		}
 
 //		if (msTicks % 1000 == 0){
 //            		// recieve message if there is a message
@@ -0,0 +1,81 @@
+#include "profile.h"
+#include "timebase.h"
+#include "debug.h"
+
+static PROFILE_ENTRY_T profile_table[PROFILE_REGION_COUNT];
+static uint32_t probe_overhead_cycles;
+
+static const char * const profile_region_names[PROFILE_REGION_COUNT] = {
+	"Process_CAN_Inputs",
+	"CAN_MakeBMSHeartbeat",
+	"DEBUG_Print"
+};
+
+static void reset_entry(PROFILE_ENTRY_T * entry) {
+	entry->count = 0;
+	entry->min_cycles = UINT32_MAX;
+	entry->max_cycles = 0;
+	entry->total_cycles = 0;
+	entry->start_cycles = 0;
+}
+
+void Profile_Init(void) {
+	uint8_t i;
+
+	probe_overhead_cycles = 0;
+	reset_entry(&profile_table[0]);
+	Profile_Enter(0);
+	Profile_Exit(0);
+	probe_overhead_cycles = profile_table[0].min_cycles;
+
+	for (i = 0; i < PROFILE_REGION_COUNT; i++) {
+		reset_entry(&profile_table[i]);
+	}
+}
+
+void Profile_Enter(PROFILE_REGION_T region) {
+	profile_table[region].start_cycles = Timebase_GetCycles();
+}
+
+void Profile_Exit(PROFILE_REGION_T region) {
+	uint32_t end_cycles = Timebase_GetCycles();
+	PROFILE_ENTRY_T * entry = &profile_table[region];
+	uint32_t elapsed = end_cycles - entry->start_cycles;
+
+	elapsed = elapsed > probe_overhead_cycles ? elapsed - probe_overhead_cycles : 0;
+
+	entry->count++;
+	entry->total_cycles += elapsed;
+	if (elapsed < entry->min_cycles) {
+		entry->min_cycles = elapsed;
+	}
+	if (elapsed > entry->max_cycles) {
+		entry->max_cycles = elapsed;
+	}
+}
+
+void Profile_Dump(void) {
+	// copy first, printing below updates the DEBUG_Print entry
+	PROFILE_ENTRY_T snapshot[PROFILE_REGION_COUNT];
+	uint8_t i;
+
+	memcpy(snapshot, profile_table, sizeof(snapshot));
+
+	DEBUG_Print("Profile (cycles): region count min max avg\r\n");
+	for (i = 0; i < PROFILE_REGION_COUNT; i++) {
+		DEBUG_Print(profile_region_names[i]);
+		DEBUG_Print(" ");
+		DEBUG_PrintNumber(snapshot[i].count, 10);
+		if (snapshot[i].count == 0) {
+			DEBUG_Print(" - - -\r\n");
+			continue;
+		}
+		DEBUG_Print(" ");
+		DEBUG_PrintNumber(snapshot[i].min_cycles, 10);
+		DEBUG_Print(" ");
+		DEBUG_PrintNumber(snapshot[i].max_cycles, 10);
+		DEBUG_Print(" ");
+		DEBUG_PrintNumber(snapshot[i].total_cycles / snapshot[i].count, 10);
+		DEBUG_Print("\r\n");
+	}
+}
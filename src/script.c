@@ -0,0 +1,336 @@
+#include <string.h>
+#include "script.h"
+#include "arena.h"
+#include "fault.h"
+#include "timebase.h"
+#include "debug.h"
+
+#define SCRIPT_MAX_DLC 8
+#define SCRIPT_ID_MASK (CAN_MSGOBJ_EXT | 0x1FFFFFFF)
+
+// the script itself lives in the arena (see arena.h)
+#define script (arena.script)
+
+typedef struct {
+	uint32_t mode_id;
+	uint16_t period_ms;
+	uint32_t last_sent;
+	uint8_t dlc;
+	uint8_t data[SCRIPT_MAX_DLC];
+} SCRIPT_PERIODIC_T;
+
+static bool loaded;
+static uint16_t script_length;
+
+// upload state
+static uint8_t header_length;
+static uint16_t load_length;
+static uint16_t load_received;
+static uint8_t load_sum;
+
+// execution state
+static bool running;
+static uint16_t pc;
+static uint8_t step;
+static uint32_t run_start_time;
+static uint32_t step_start_time;
+static uint32_t step_start_cycles;
+static bool expect_matched;
+static uint32_t expect_match_cycles;
+static SCRIPT_PERIODIC_T periodic[SCRIPT_PERIODIC_SLOTS];
+
+static uint16_t read16(const uint8_t * bytes) {
+	return ((uint16_t) bytes[0] << 8) | bytes[1];
+}
+
+static uint32_t read32(const uint8_t * bytes) {
+	return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | bytes[3];
+}
+
+/**
+ * @details size of the step at the start of bytes, including its operands
+ *
+ * @param remaining bytes left in the script from the start of the step
+ * @return 0 if the step is invalid or doesn't fit in remaining
+ */
+static uint16_t step_size(const uint8_t * bytes, uint16_t remaining) {
+	uint16_t size;
+
+	switch (bytes[0]) {
+		case SCRIPT_OP_END:
+			size = 1;
+			break;
+		case SCRIPT_OP_SEND:
+			if (remaining < 6 || bytes[5] > SCRIPT_MAX_DLC) {
+				return 0;
+			}
+			size = 6 + bytes[5];
+			break;
+		case SCRIPT_OP_PERIODIC:
+			if (remaining < 9 || bytes[1] >= SCRIPT_PERIODIC_SLOTS || bytes[8] > SCRIPT_MAX_DLC) {
+				return 0;
+			}
+			size = 9 + bytes[8];
+			break;
+		case SCRIPT_OP_EXPECT:
+			if (remaining < 8 || bytes[7] > SCRIPT_MAX_DLC) {
+				return 0;
+			}
+			size = 8 + 2 * bytes[7];
+			break;
+		case SCRIPT_OP_WAIT:
+			size = 3;
+			break;
+		default:
+			return 0;
+	}
+	return size <= remaining ? size : 0;
+}
+
+/**
+ * @return true if every step is valid and the last one is SCRIPT_OP_END
+ */
+static bool validate(uint16_t length) {
+	uint16_t offset = 0;
+
+	while (offset < length) {
+		uint16_t size = step_size(&script[offset], length - offset);
+		if (size == 0) {
+			return false;
+		}
+		if (script[offset] == SCRIPT_OP_END) {
+			return offset + size == length;
+		}
+		offset += size;
+	}
+	return false;
+}
+
+static void stop_periodic(void) {
+	uint8_t i;
+
+	for (i = 0; i < SCRIPT_PERIODIC_SLOTS; i++) {
+		periodic[i].period_ms = 0;
+	}
+}
+
+static void print_step(const char * name) {
+	DEBUG_Print("Step ");
+	DEBUG_PrintNumber(step, 10);
+	DEBUG_Print(" ");
+	DEBUG_Print(name);
+	DEBUG_Print(" ");
+	DEBUG_PrintNumber(read32(&script[pc + 1]) & 0x1FFFFFFF, 16);
+	DEBUG_Print(": ");
+}
+
+static void finish(bool passed) {
+	running = false;
+	stop_periodic();
+	if (passed) {
+		DEBUG_Print("Script passed in ");
+		DEBUG_PrintNumber(msTicks - run_start_time, 10);
+		DEBUG_Print(" ms\r\n");
+	} else {
+		DEBUG_Print("Script failed at step ");
+		DEBUG_PrintNumber(step, 10);
+		DEBUG_Print("\r\n");
+	}
+}
+
+static void next_step(uint16_t size) {
+	pc += size;
+	step++;
+	step_start_time = msTicks;
+	step_start_cycles = Timebase_GetCycles();
+	expect_matched = false;
+}
+
+static bool send_due_periodic(void) {
+	bool sent = false;
+	uint8_t i;
+
+	for (i = 0; i < SCRIPT_PERIODIC_SLOTS; i++) {
+		SCRIPT_PERIODIC_T * slot = &periodic[i];
+
+		if (slot->period_ms == 0 || msTicks - slot->last_sent < slot->period_ms) {
+			continue;
+		}
+		slot->last_sent += slot->period_ms;
+		// don't try to catch up after a stall, just resume the period
+		if (msTicks - slot->last_sent >= slot->period_ms) {
+			slot->last_sent = msTicks;
+		}
+		Fault_Transmit(slot->mode_id, slot->data, slot->dlc);
+		sent = true;
+	}
+	return sent;
+}
+
+void Script_Init(void) {
+	loaded = false;
+	script_length = 0;
+	header_length = 0;
+	running = false;
+	stop_periodic();
+}
+
+void Script_BeginLoad(void) {
+	if (running) {
+		Script_Abort();
+	}
+	loaded = false;
+	header_length = 0;
+	load_length = 0;
+	load_received = 0;
+	load_sum = 0;
+}
+
+SCRIPT_LOAD_T Script_LoadByte(uint8_t byte) {
+	if (header_length < 2) {
+		load_length = (load_length << 8) | byte;
+		header_length++;
+		if (header_length == 2 && (load_length == 0 || load_length > SCRIPT_MAX_SIZE)) {
+			return SCRIPT_LOAD_ERROR;
+		}
+		return SCRIPT_LOAD_MORE;
+	}
+
+	if (load_received < load_length) {
+		script[load_received++] = byte;
+		load_sum += byte;
+		return SCRIPT_LOAD_MORE;
+	}
+
+	if (byte != load_sum || !validate(load_length)) {
+		return SCRIPT_LOAD_ERROR;
+	}
+	script_length = load_length;
+	loaded = true;
+	Arena_Mark(ARENA_SCRIPT, script_length);
+	return SCRIPT_LOAD_DONE;
+}
+
+bool Script_Start(void) {
+	if (!loaded) {
+		return false;
+	}
+	stop_periodic();
+	running = true;
+	pc = 0;
+	step = 0;
+	run_start_time = msTicks;
+	next_step(0);
+	return true;
+}
+
+void Script_Abort(void) {
+	if (running) {
+		finish(false);
+	}
+}
+
+bool Script_IsRunning(void) {
+	return running;
+}
+
+void Script_Receive(const CCAN_MSG_OBJ_T * msg_obj, uint32_t rx_cycles) {
+	const uint8_t * expect = &script[pc];
+	uint8_t len;
+	uint8_t i;
+
+	if (!running || expect_matched || expect[0] != SCRIPT_OP_EXPECT) {
+		return;
+	}
+	if ((msg_obj->mode_id & SCRIPT_ID_MASK) != read32(&expect[1])) {
+		return;
+	}
+	// buffered before the step started, steps time out well within the
+	// 89 s the cycle count takes to wrap
+	if ((int32_t) (rx_cycles - step_start_cycles) < 0) {
+		return;
+	}
+	len = expect[7];
+	if (msg_obj->dlc < len) {
+		return;
+	}
+	for (i = 0; i < len; i++) {
+		if ((msg_obj->data[i] & expect[8 + len + i]) != expect[8 + i]) {
+			return;
+		}
+	}
+	expect_matched = true;
+	expect_match_cycles = rx_cycles;
+}
+
+bool Script_Update(void) {
+	bool busy;
+
+	if (!running) {
+		return false;
+	}
+
+	busy = send_due_periodic();
+
+	// every step that doesn't wait moves pc forward and the script ends
+	// with SCRIPT_OP_END, so this terminates
+	while (running) {
+		const uint8_t * bytes = &script[pc];
+		uint16_t size = step_size(bytes, script_length - pc);
+		SCRIPT_PERIODIC_T * slot;
+
+		switch (bytes[0]) {
+			case SCRIPT_OP_END:
+				finish(true);
+				return true;
+			case SCRIPT_OP_SEND:
+				if (!Fault_Transmit(read32(&bytes[1]), &bytes[6], bytes[5])) {
+					print_step("send");
+					DEBUG_Print("transmit queue full\r\n");
+					finish(false);
+					return true;
+				}
+				break;
+			case SCRIPT_OP_PERIODIC:
+				slot = &periodic[bytes[1]];
+				slot->period_ms = read16(&bytes[2]);
+				slot->mode_id = read32(&bytes[4]);
+				slot->dlc = bytes[8];
+				memcpy(slot->data, &bytes[9], slot->dlc);
+				slot->last_sent = msTicks;
+				if (slot->period_ms != 0) {
+					Fault_Transmit(slot->mode_id, slot->data, slot->dlc);
+				}
+				break;
+			case SCRIPT_OP_EXPECT:
+				if (expect_matched) {
+					print_step("expect");
+					DEBUG_Print("ok after ");
+					DEBUG_PrintNumber(Timebase_CyclesToMicros(expect_match_cycles - step_start_cycles), 10);
+					DEBUG_Print(" us\r\n");
+					break;
+				}
+				if (msTicks - step_start_time >= read16(&bytes[5])) {
+					print_step("expect");
+					DEBUG_Print("timed out after ");
+					DEBUG_PrintNumber(read16(&bytes[5]), 10);
+					DEBUG_Print(" ms\r\n");
+					finish(false);
+					return true;
+				}
+				return busy;
+			case SCRIPT_OP_WAIT:
+				if (msTicks - step_start_time < read16(&bytes[1])) {
+					return busy;
+				}
+				break;
+			default:
+				// validated on upload, can't happen
+				finish(false);
+				return true;
+		}
+		next_step(size);
+		busy = true;
+	}
+	return busy;
+}
@@ -0,0 +1,143 @@
+#include <string.h>
+#include "serial.h"
+#include "chip.h"
+#include "arena.h"
+#include "timebase.h"
+
+// both buffers live in the arena (see arena.h)
+static RINGBUFF_T rx_ring;
+static volatile uint32_t rx_cycles;
+
+// Transmit double buffer: the main loop appends to the fill buffer while
+// the UART interrupt drains the other one into the 16 byte hardware FIFO.
+// When the drain buffer empties the interrupt swaps the two.
+#define tx_bufs(index) (&arena.serial_tx[(index) * SERIAL_TX_BUFFER_SIZE])
+static volatile uint8_t tx_fill_index;
+static volatile uint16_t tx_fill_len;
+static const uint8_t * volatile tx_drain_ptr;
+static volatile uint16_t tx_drain_len;
+static uint32_t tx_stalls;
+
+static uint32_t current_baudrate;
+
+static void tx_swap_buffers(void) {
+	tx_drain_ptr = tx_bufs(tx_fill_index);
+	tx_drain_len = tx_fill_len;
+	tx_fill_index ^= 1;
+	tx_fill_len = 0;
+}
+
+static void tx_handler(void) {
+	uint8_t fifo_space = UART_TX_FIFO_SIZE;
+
+	if (tx_drain_len == 0) {
+		tx_swap_buffers();
+	}
+	if (tx_drain_len == 0) {
+		Chip_UART_IntDisable(LPC_USART, UART_IER_THREINT);
+		return;
+	}
+
+	while (fifo_space > 0 && tx_drain_len > 0) {
+		Chip_UART_SendByte(LPC_USART, *tx_drain_ptr++);
+		tx_drain_len--;
+		fifo_space--;
+	}
+}
+
+void UART_IRQHandler(void) {
+	if (Chip_UART_ReadLineStatus(LPC_USART) & UART_LSR_RDR) {
+		rx_cycles = Timebase_GetCycles();
+	}
+	Chip_UART_RXIntHandlerRB(LPC_USART, &rx_ring);
+	Arena_Mark(ARENA_SERIAL_RX, RingBuffer_GetCount(&rx_ring));
+
+	if ((Chip_UART_GetIntsEnabled(LPC_USART) & UART_IER_THREINT) &&
+		(Chip_UART_ReadLineStatus(LPC_USART) & UART_LSR_THRE)) {
+		tx_handler();
+	}
+}
+
+void Serial_Init(uint32_t baudrate) {
+	Chip_IOCON_PinMuxSet(LPC_IOCON, IOCON_PIO1_6, (IOCON_FUNC1 | IOCON_MODE_INACT)); /* RXD */
+	Chip_IOCON_PinMuxSet(LPC_IOCON, IOCON_PIO1_7, (IOCON_FUNC1 | IOCON_MODE_INACT)); /* TXD */
+
+	Chip_UART_Init(LPC_USART);
+	current_baudrate = Chip_UART_SetBaudFDR(LPC_USART, baudrate);
+	// Configure data width, parity, and stop bits
+	Chip_UART_ConfigData(LPC_USART, (UART_LCR_WLEN8 | UART_LCR_SBS_1BIT | UART_LCR_PARITY_DIS));
+	Chip_UART_SetupFIFOS(LPC_USART, (UART_FCR_FIFO_EN | UART_FCR_TRG_LEV2));
+	Chip_UART_TXEnable(LPC_USART);
+
+	RingBuffer_Init(&rx_ring, arena.serial_rx, sizeof(uint8_t), SERIAL_RX_BUFFER_SIZE);
+	tx_fill_index = 0;
+	tx_fill_len = 0;
+	tx_drain_len = 0;
+	tx_stalls = 0;
+
+	Chip_UART_IntEnable(LPC_USART, (UART_IER_RBRINT | UART_IER_RLSINT));
+	NVIC_EnableIRQ(UART0_IRQn);
+}
+
+uint32_t Serial_Read(uint8_t * buf, uint32_t len) {
+	return Chip_UART_ReadRB(LPC_USART, &rx_ring, buf, len);
+}
+
+uint32_t Serial_LastRxCycles(void) {
+	return rx_cycles;
+}
+
+bool Serial_RxPending(void) {
+	return !RingBuffer_IsEmpty(&rx_ring);
+}
+
+void Serial_Write(const void * data, uint32_t len) {
+	const uint8_t * bytes = data;
+
+	while (len > 0) {
+		uint32_t chunk;
+
+		// the interrupt swaps buffers, keep it out while appending
+		Chip_UART_IntDisable(LPC_USART, UART_IER_THREINT);
+		chunk = SERIAL_TX_BUFFER_SIZE - tx_fill_len;
+		if (chunk > len) {
+			chunk = len;
+		}
+		memcpy(tx_bufs(tx_fill_index) + tx_fill_len, bytes, chunk);
+		tx_fill_len += chunk;
+		Arena_Mark(ARENA_SERIAL_TX, tx_fill_len + tx_drain_len);
+		Chip_UART_IntEnable(LPC_USART, UART_IER_THREINT);
+
+		bytes += chunk;
+		len -= chunk;
+
+		if (len > 0) {
+			// both buffers are full, wait for the interrupt to swap
+			tx_stalls++;
+			while (tx_fill_len == SERIAL_TX_BUFFER_SIZE);
+		}
+	}
+}
+
+uint32_t Serial_TxSpace(void) {
+	return SERIAL_TX_BUFFER_SIZE - tx_fill_len;
+}
+
+uint32_t Serial_TxStalls(void) {
+	return tx_stalls;
+}
+
+void Serial_Flush(void) {
+	while (tx_fill_len != 0 || tx_drain_len != 0);
+	while (!(Chip_UART_ReadLineStatus(LPC_USART) & UART_LSR_TEMT));
+}
+
+uint32_t Serial_SetBaud(uint32_t baudrate) {
+	Serial_Flush();
+	current_baudrate = Chip_UART_SetBaudFDR(LPC_USART, baudrate);
+	return current_baudrate;
+}
+
+uint32_t Serial_GetBaud(void) {
+	return current_baudrate;
+}
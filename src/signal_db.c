@@ -0,0 +1,112 @@
+#include <string.h>
+#include "signal_db.h"
+#include "can_bus.h"
+#include "timebase.h"
+#include "seqlock.h"
+
+#define SIGNAL_DB_INDEX_BITS 5
+#define SIGNAL_DB_INDEX_SIZE (1 << SIGNAL_DB_INDEX_BITS)
+
+// room for every message even if each signal had an id of its own
+typedef char signal_db_index_fits[(SIGNAL_DB_INDEX_SIZE >= CAN_SIGNAL_COUNT) ? 1 : -1];
+
+typedef struct {
+	uint32_t value;
+	uint32_t updated_ms;
+} SIGNAL_DB_ENTRY_T;
+
+typedef struct {
+	uint16_t id;
+	uint8_t first;
+	// 0 marks a free slot
+	uint8_t count;
+} SIGNAL_DB_MESSAGE_T;
+
+static SIGNAL_DB_ENTRY_T entries[CAN_SIGNAL_COUNT];
+static bool received[CAN_SIGNAL_COUNT];
+// readers get value and time from the same frame should updates move into
+// the CAN receive interrupt
+static SEQLOCK_T entries_lock;
+// signals of each message by id, open addressing as in dispatch.c
+static SIGNAL_DB_MESSAGE_T messages[SIGNAL_DB_INDEX_SIZE];
+
+/**
+ * @details Fibonacci hashing, see dispatch.c
+ */
+RAMFUNC static uint32_t index_hash(uint32_t id) {
+	return (uint32_t) (id * 2654435761UL) >> (32 - SIGNAL_DB_INDEX_BITS);
+}
+
+/**
+ * @return the slot of the message with the id, or the free slot where it
+ * belongs
+ */
+RAMFUNC static SIGNAL_DB_MESSAGE_T * find_message(uint32_t id) {
+	uint32_t index = index_hash(id);
+
+	// never full, see signal_db_index_fits
+	while (messages[index].count != 0 && messages[index].id != id) {
+		index = (index + 1) & (SIGNAL_DB_INDEX_SIZE - 1);
+	}
+	return &messages[index];
+}
+
+void SignalDb_Init(void) {
+	uint8_t i;
+
+	memset(entries, 0, sizeof(entries));
+	memset(received, 0, sizeof(received));
+
+	// the signals of a message are listed together in CAN_SIGNALS
+	memset(messages, 0, sizeof(messages));
+	for (i = 0; i < CAN_SIGNAL_COUNT; i++) {
+		SIGNAL_DB_MESSAGE_T * message = find_message(CAN_Signals[i].id);
+		if (message->count == 0) {
+			message->id = CAN_Signals[i].id;
+			message->first = i;
+		}
+		message->count++;
+	}
+}
+
+RAMFUNC void SignalDb_Update(const CCAN_MSG_OBJ_T * msg_obj, uint32_t received_ms) {
+	uint32_t id = msg_obj->mode_id & CAN_BUS_MAX_STD_ID;
+	const SIGNAL_DB_MESSAGE_T * message;
+	uint8_t i;
+
+	if (msg_obj->mode_id & (CAN_MSGOBJ_EXT | CAN_MSGOBJ_RTR)) {
+		return;
+	}
+	message = find_message(id);
+	if (message->count == 0) {
+		return;
+	}
+
+	Seqlock_WriteBegin(&entries_lock);
+	for (i = message->first; i < message->first + message->count; i++) {
+		// the frame is too short to hold it
+		if (!CAN_SignalInFrame(i, msg_obj->dlc)) {
+			continue;
+		}
+		entries[i].value = CAN_ExtractSignal(msg_obj, i);
+		entries[i].updated_ms = received_ms;
+		received[i] = true;
+	}
+	Seqlock_WriteEnd(&entries_lock);
+}
+
+bool SignalDb_Get(CAN_SIGNAL_T signal, uint32_t * value, uint32_t * updated_ms) {
+	SIGNAL_DB_ENTRY_T entry;
+	bool was_received;
+	uint32_t sequence;
+
+	do {
+		sequence = Seqlock_ReadBegin(&entries_lock);
+		entry = entries[signal];
+		was_received = received[signal];
+	} while (Seqlock_ReadRetry(&entries_lock, sequence));
+
+	*value = entry.value;
+	*updated_ms = entry.updated_ms;
+	return was_received;
+}
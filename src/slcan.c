@@ -0,0 +1,590 @@
+#include "slcan.h"
+#include "can.h"
+#include "can_bus.h"
+#include "serial.h"
+#include "timebase.h"
+#include "arena.h"
+#include "signal_db.h"
+
+#define SLCAN_LINE_SIZE 32
+#define SLCAN_TIMESTAMP_MODULO 60000
+#define SLCAN_SYNC_PERIOD_MS 1000
+
+#define SLCAN_OK '\r'
+#define SLCAN_ERROR '\a'
+
+#define SLCAN_FLAG_EXT 0x80
+#define SLCAN_FLAG_RTR 0x40
+#define SLCAN_FLAG_DLC 0x0F
+
+#define SLCAN_MAX_DLC 8
+
+// largest query answer: marker, time, count and an entry per signal
+#define SLCAN_QUERY_ENTRY_SIZE 9
+#define SLCAN_MAX_ANSWER (1 + 4 + 1 + CAN_SIGNAL_COUNT * SLCAN_QUERY_ENTRY_SIZE)
+#define SLCAN_QUERY_NEVER_RECEIVED 0x80
+
+// answers are built in the frame batch buffer
+typedef char slcan_answer_fits[(SLCAN_MAX_ANSWER <= SLCAN_RX_BATCH * SLCAN_MAX_ENCODED) ? 1 : -1];
+
+typedef enum {
+	SLCAN_TIMESTAMPS_OFF,
+	SLCAN_TIMESTAMPS_MS,
+	SLCAN_TIMESTAMPS_US
+} SLCAN_TIMESTAMPS_T;
+
+static const uint32_t slcan_bitrates[] = {
+	10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000
+};
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+static bool active;
+static bool channel_open;
+static uint8_t timestamps;
+static uint32_t last_sync_time;
+static bool binary;
+
+static uint32_t bitrate;
+
+// the tester's own CAN settings, restored when the gateway stops
+static uint32_t tester_bitrate;
+static bool tester_listen_only;
+
+static char line[SLCAN_LINE_SIZE];
+static uint8_t line_length;
+static bool line_overflow;
+
+static uint8_t binary_frame[2 + 4 + SLCAN_MAX_DLC];
+static uint8_t binary_length;
+
+// count followed by the queried signals
+static uint8_t query[1 + CAN_SIGNAL_COUNT];
+static uint8_t query_length;
+
+static CCAN_MSG_OBJ_T rx_frame;
+
+static void reply(char c) {
+	Serial_Write(&c, 1);
+}
+
+static void reply_text(const char * text, uint32_t len) {
+	Serial_Write(text, len);
+}
+
+/**
+ * @details parses exactly digits hex characters
+ *
+ * @return false if any of them is not a hex digit
+ */
+static bool parse_hex_digits(const char * text, uint8_t digits, uint32_t * value) {
+	uint8_t i;
+
+	*value = 0;
+	for (i = 0; i < digits; i++) {
+		char c = text[i];
+		uint8_t nibble;
+		if (c >= '0' && c <= '9') {
+			nibble = c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			nibble = c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			nibble = c - 'A' + 10;
+		} else {
+			return false;
+		}
+		*value = (*value << 4) | nibble;
+	}
+	return true;
+}
+
+static uint8_t put_hex(uint8_t * out, uint32_t value, uint8_t digits) {
+	int8_t digit;
+
+	for (digit = digits - 1; digit >= 0; digit--) {
+		*out++ = hex_digits[(value >> (digit * 4)) & 0xF];
+	}
+	return digits;
+}
+
+static uint8_t put_big_endian(uint8_t * out, uint64_t value, uint8_t bytes) {
+	int8_t byte;
+
+	for (byte = bytes - 1; byte >= 0; byte--) {
+		*out++ = value >> (byte * 8);
+	}
+	return bytes;
+}
+
+/**
+ * @param rx_cycles Timebase_GetCycles reading when the frame was received
+ * @return number of bytes written to out, at most SLCAN_MAX_ENCODED
+ */
+static uint8_t encode_ascii(const CCAN_MSG_OBJ_T * msg_obj, uint32_t rx_cycles, uint8_t * out) {
+	bool extended = msg_obj->mode_id & CAN_MSGOBJ_EXT;
+	bool remote = msg_obj->mode_id & CAN_MSGOBJ_RTR;
+	uint8_t dlc = msg_obj->dlc & SLCAN_FLAG_DLC;
+	uint8_t length = 0;
+	uint8_t i;
+
+	if (dlc > SLCAN_MAX_DLC) {
+		dlc = SLCAN_MAX_DLC;
+	}
+
+	if (extended) {
+		out[length++] = remote ? 'R' : 'T';
+		length += put_hex(&out[length], msg_obj->mode_id & CAN_BUS_MAX_EXT_ID, 8);
+	} else {
+		out[length++] = remote ? 'r' : 't';
+		length += put_hex(&out[length], msg_obj->mode_id & CAN_BUS_MAX_STD_ID, 3);
+	}
+	out[length++] = '0' + dlc;
+	if (!remote) {
+		for (i = 0; i < dlc; i++) {
+			length += put_hex(&out[length], msg_obj->data[i], 2);
+		}
+	}
+	if (timestamps == SLCAN_TIMESTAMPS_MS) {
+		length += put_hex(&out[length], Timebase_MillisAt(rx_cycles) % SLCAN_TIMESTAMP_MODULO, 4);
+	} else if (timestamps == SLCAN_TIMESTAMPS_US) {
+		length += put_hex(&out[length], Timebase_MicrosAt(rx_cycles), 8);
+	}
+	out[length++] = '\r';
+	return length;
+}
+
+/**
+ * @param rx_cycles Timebase_GetCycles reading when the frame was received
+ * @return number of bytes written to out
+ */
+static uint8_t encode_binary(const CCAN_MSG_OBJ_T * msg_obj, uint32_t rx_cycles, uint8_t * out) {
+	bool extended = msg_obj->mode_id & CAN_MSGOBJ_EXT;
+	bool remote = msg_obj->mode_id & CAN_MSGOBJ_RTR;
+	uint32_t id = msg_obj->mode_id & CAN_BUS_MAX_EXT_ID;
+	uint8_t dlc = msg_obj->dlc & SLCAN_FLAG_DLC;
+	uint8_t length = 0;
+	uint8_t i;
+
+	if (dlc > SLCAN_MAX_DLC) {
+		dlc = SLCAN_MAX_DLC;
+	}
+
+	out[length++] = SLCAN_BINARY_FRAME;
+	out[length++] = (extended ? SLCAN_FLAG_EXT : 0) | (remote ? SLCAN_FLAG_RTR : 0) | dlc;
+	if (extended) {
+		out[length++] = id >> 24;
+		out[length++] = id >> 16;
+	}
+	out[length++] = id >> 8;
+	out[length++] = id;
+	if (!remote) {
+		for (i = 0; i < dlc; i++) {
+			out[length++] = msg_obj->data[i];
+		}
+	}
+	if (timestamps == SLCAN_TIMESTAMPS_MS) {
+		length += put_big_endian(&out[length], Timebase_MillisAt(rx_cycles) % SLCAN_TIMESTAMP_MODULO, 2);
+	} else if (timestamps == SLCAN_TIMESTAMPS_US) {
+		length += put_big_endian(&out[length], Timebase_MicrosAt(rx_cycles), 4);
+	}
+	return length;
+}
+
+/**
+ * @return true if the frame was handed to the CAN controller
+ */
+static bool transmit(uint32_t mode_id, uint8_t * data, uint8_t dlc) {
+	if (!channel_open || CanBus_IsListenOnly()) {
+		return false;
+	}
+	return CanBus_Transmit(mode_id, data, dlc);
+}
+
+static void open_channel(bool listen) {
+	CanBus_Configure(bitrate, listen);
+	channel_open = true;
+}
+
+/**
+ * @details parses and sends a t, T, r or R command
+ *
+ * @return false if the command is malformed or the frame could not be sent
+ */
+static bool transmit_line(void) {
+	bool extended = line[0] == 'T' || line[0] == 'R';
+	bool remote = line[0] == 'r' || line[0] == 'R';
+	uint8_t id_digits = extended ? 8 : 3;
+	uint8_t data[SLCAN_MAX_DLC];
+	uint32_t mode_id;
+	uint32_t value;
+	uint8_t dlc;
+	uint8_t pos = 1;
+	uint8_t i;
+
+	if (line_length < pos + id_digits + 1 || !parse_hex_digits(&line[pos], id_digits, &mode_id)) {
+		return false;
+	}
+	pos += id_digits;
+	if (mode_id > (extended ? CAN_BUS_MAX_EXT_ID : CAN_BUS_MAX_STD_ID)) {
+		return false;
+	}
+
+	dlc = line[pos++] - '0';
+	if (dlc > SLCAN_MAX_DLC) {
+		return false;
+	}
+	if (!remote) {
+		if (line_length < pos + dlc * 2) {
+			return false;
+		}
+		for (i = 0; i < dlc; i++) {
+			if (!parse_hex_digits(&line[pos], 2, &value)) {
+				return false;
+			}
+			data[i] = value;
+			pos += 2;
+		}
+	}
+
+	mode_id |= (extended ? CAN_MSGOBJ_EXT : 0) | (remote ? CAN_MSGOBJ_RTR : 0);
+	return transmit(mode_id, data, dlc);
+}
+
+/**
+ * @details executes a complete ASCII command line
+ */
+static void execute_line(void) {
+	uint8_t index;
+
+	if (line_length == 0) {
+		reply(SLCAN_OK);
+		return;
+	}
+
+	switch (line[0]) {
+		case 'S':
+			index = line[1] - '0';
+			if (channel_open || line_length != 2 || index >= sizeof(slcan_bitrates) / sizeof(slcan_bitrates[0])) {
+				reply(SLCAN_ERROR);
+				return;
+			}
+			bitrate = slcan_bitrates[index];
+			break;
+		case 'O':
+		case 'L':
+			if (channel_open) {
+				reply(SLCAN_ERROR);
+				return;
+			}
+			open_channel(line[0] == 'L');
+			break;
+		case 'C':
+			channel_open = false;
+			break;
+		case 't':
+		case 'T':
+		case 'r':
+		case 'R':
+			if (!transmit_line()) {
+				reply(SLCAN_ERROR);
+				return;
+			}
+			reply(line[0] == 't' || line[0] == 'r' ? 'z' : 'Z');
+			break;
+		case 'Z':
+			if (line_length != 2 || line[1] < '0' || line[1] > '0' + SLCAN_TIMESTAMPS_US) {
+				reply(SLCAN_ERROR);
+				return;
+			}
+			timestamps = line[1] - '0';
+			break;
+		case 'V':
+			reply_text("V0101", 5);
+			break;
+		case 'N':
+			reply_text("NEVT1", 5);
+			break;
+		case 'F':
+			reply_text("F00", 3);
+			break;
+		case 'M':
+		case 'm':
+			// SJA1000 acceptance registers, nothing to map them to here
+			break;
+		case 'b':
+			binary = true;
+			binary_length = 0;
+			break;
+		default:
+			reply(SLCAN_ERROR);
+			return;
+	}
+	reply(SLCAN_OK);
+}
+
+static void process_ascii_byte(uint8_t byte) {
+	if (byte == SLCAN_EXIT_KEY) {
+		Slcan_SetActive(false);
+		return;
+	}
+	if (byte == '\n') {
+		return;
+	}
+	if (byte != '\r') {
+		if (line_length < SLCAN_LINE_SIZE) {
+			line[line_length++] = byte;
+		} else {
+			line_overflow = true;
+		}
+		return;
+	}
+
+	if (line_overflow) {
+		reply(SLCAN_ERROR);
+	} else {
+		execute_line();
+	}
+	line_length = 0;
+	line_overflow = false;
+}
+
+/**
+ * @return number of bytes a binary frame with these flags occupies after
+ * the 0xAA marker
+ */
+static uint8_t binary_frame_length(uint8_t flags) {
+	uint8_t length = 1 + ((flags & SLCAN_FLAG_EXT) ? 4 : 2);
+
+	if (!(flags & SLCAN_FLAG_RTR)) {
+		length += flags & SLCAN_FLAG_DLC;
+	}
+	return length;
+}
+
+static void transmit_binary_frame(void) {
+	uint8_t flags = binary_frame[0];
+	uint8_t dlc = flags & SLCAN_FLAG_DLC;
+	uint32_t mode_id;
+	uint8_t pos;
+
+	if (flags & SLCAN_FLAG_EXT) {
+		mode_id = ((uint32_t) binary_frame[1] << 24) | ((uint32_t) binary_frame[2] << 16) |
+			((uint32_t) binary_frame[3] << 8) | binary_frame[4];
+		pos = 5;
+		mode_id = (mode_id & CAN_BUS_MAX_EXT_ID) | CAN_MSGOBJ_EXT;
+	} else {
+		mode_id = (((uint32_t) binary_frame[1] << 8) | binary_frame[2]) & CAN_BUS_MAX_STD_ID;
+		pos = 3;
+	}
+	if (flags & SLCAN_FLAG_RTR) {
+		mode_id |= CAN_MSGOBJ_RTR;
+	}
+
+	if (!transmit(mode_id, &binary_frame[pos], dlc)) {
+		reply(SLCAN_ERROR);
+	}
+}
+
+/**
+ * @details answers a ping with the time it arrived, stamped in the UART
+ * interrupt, and the time the answer is queued
+ */
+static void send_pong(void) {
+	uint8_t pong[1 + 8 + 8];
+	uint64_t received_us = Timebase_MicrosAt(Serial_LastRxCycles());
+
+	pong[0] = SLCAN_BINARY_PONG;
+	put_big_endian(&pong[1], received_us, 8);
+	put_big_endian(&pong[9], Timebase_GetMicros(), 8);
+	Serial_Write(pong, sizeof(pong));
+}
+
+/**
+ * @details sends a sync record every SLCAN_SYNC_PERIOD_MS while frames
+ * carry microsecond timestamps, so the host can extend them past 32 bits
+ */
+static void send_sync(void) {
+	uint8_t sync[1 + 8];
+
+	if (!binary || timestamps != SLCAN_TIMESTAMPS_US || msTicks - last_sync_time < SLCAN_SYNC_PERIOD_MS ||
+		Serial_TxSpace() < sizeof(sync)) {
+		return;
+	}
+	last_sync_time = msTicks;
+	sync[0] = SLCAN_BINARY_SYNC;
+	put_big_endian(&sync[1], Timebase_GetMicros(), 8);
+	Serial_Write(sync, sizeof(sync));
+}
+
+/**
+ * @details answers a query with the latest value of each signal and when
+ * it was received, see slcan.h
+ */
+static void answer_query(void) {
+	uint8_t * out = arena.slcan_batch;
+	uint32_t length = 0;
+	uint32_t value;
+	uint32_t updated_ms;
+	uint8_t i;
+
+	for (i = 0; i < query[0]; i++) {
+		if (query[1 + i] >= CAN_SIGNAL_COUNT) {
+			reply(SLCAN_ERROR);
+			return;
+		}
+	}
+
+	out[length++] = SLCAN_BINARY_QUERY;
+	length += put_big_endian(&out[length], msTicks, 4);
+	out[length++] = query[0];
+	for (i = 0; i < query[0]; i++) {
+		uint8_t signal = query[1 + i];
+		bool seen = SignalDb_Get(signal, &value, &updated_ms);
+		out[length++] = seen ? signal : signal | SLCAN_QUERY_NEVER_RECEIVED;
+		length += put_big_endian(&out[length], value, 4);
+		length += put_big_endian(&out[length], updated_ms, 4);
+	}
+	Arena_Mark(ARENA_SLCAN_BATCH, length);
+	Serial_Write(out, length);
+}
+
+static void process_query_byte(uint8_t byte) {
+	query[query_length - 1] = byte;
+	query_length++;
+	if (query[0] > CAN_SIGNAL_COUNT) {
+		query_length = 0;
+		reply(SLCAN_ERROR);
+	} else if (query_length - 1 == 1 + query[0]) {
+		query_length = 0;
+		answer_query();
+	}
+}
+
+static void process_binary_byte(uint8_t byte) {
+	if (query_length != 0) {
+		process_query_byte(byte);
+		return;
+	}
+	if (binary_length == 0) {
+		if (byte == SLCAN_BINARY_EXIT) {
+			binary = false;
+			line_length = 0;
+			reply(SLCAN_OK);
+		} else if (byte == SLCAN_BINARY_PING) {
+			send_pong();
+		} else if (byte == SLCAN_BINARY_QUERY) {
+			query_length = 1;
+		} else if (byte == SLCAN_BINARY_FRAME) {
+			binary_length = 1;
+		}
+		// anything else is line noise between frames
+		return;
+	}
+
+	if (binary_length == 1 && (byte & SLCAN_FLAG_DLC) > SLCAN_MAX_DLC) {
+		binary_length = 0;
+		reply(SLCAN_ERROR);
+		return;
+	}
+
+	binary_frame[binary_length - 1] = byte;
+	binary_length++;
+	if (binary_length - 1 == binary_frame_length(binary_frame[0])) {
+		transmit_binary_frame();
+		binary_length = 0;
+	}
+}
+
+/**
+ * @details forwards up to SLCAN_RX_BATCH received frames in a single UART
+ * write, leaving frames in the CAN library buffer once the UART transmit
+ * buffer cannot take another one without blocking
+ *
+ * @return true if any frame was received
+ */
+static bool forward_frames(void) {
+	uint32_t space = Serial_TxSpace();
+	uint32_t length = 0;
+	uint32_t rx_cycles;
+	uint8_t frames;
+
+	for (frames = 0; frames < SLCAN_RX_BATCH; frames++) {
+		if (space < length + SLCAN_MAX_ENCODED) {
+			break;
+		}
+		if (CanBus_Receive(&rx_frame, &rx_cycles) != NO_CAN_ERROR) {
+			break;
+		}
+		SignalDb_Update(&rx_frame, Timebase_MillisAt(rx_cycles));
+		if (!channel_open) {
+			continue;
+		}
+		length += binary ? encode_binary(&rx_frame, rx_cycles, &arena.slcan_batch[length]) : encode_ascii(&rx_frame, rx_cycles, &arena.slcan_batch[length]);
+	}
+
+	if (length != 0) {
+		Arena_Mark(ARENA_SLCAN_BATCH, length);
+		Serial_Write(arena.slcan_batch, length);
+	}
+	return frames != 0;
+}
+
+void Slcan_Init(void) {
+	active = false;
+	channel_open = false;
+	timestamps = SLCAN_TIMESTAMPS_OFF;
+	last_sync_time = msTicks - SLCAN_SYNC_PERIOD_MS;
+	binary = false;
+	bitrate = CAN_BUS_DEFAULT_BITRATE;
+	line_length = 0;
+	line_overflow = false;
+	binary_length = 0;
+	query_length = 0;
+}
+
+void Slcan_SetActive(bool enable) {
+	if (enable == active) {
+		return;
+	}
+	if (enable) {
+		tester_bitrate = CanBus_GetBitrate();
+		tester_listen_only = CanBus_IsListenOnly();
+	} else {
+		// the rest of the tester expects its own settings back
+		CanBus_Configure(tester_bitrate, tester_listen_only);
+	}
+	Slcan_Init();
+	if (enable) {
+		// until the host picks a rate with S
+		bitrate = tester_bitrate;
+	}
+	active = enable;
+}
+
+bool Slcan_IsActive(void) {
+	return active;
+}
+
+bool Slcan_Process(void) {
+	uint8_t buf[16];
+	uint32_t count;
+	uint32_t i;
+	bool busy = false;
+
+	while (active && (count = Serial_Read(buf, sizeof(buf))) != 0) {
+		busy = true;
+		for (i = 0; i < count && active; i++) {
+			if (binary) {
+				process_binary_byte(buf[i]);
+			} else {
+				process_ascii_byte(buf[i]);
+			}
+		}
+	}
+
+	if (active) {
+		busy |= forward_frames();
+		send_sync();
+	}
+	return busy;
+}
@@ -0,0 +1,122 @@
+#include "telemetry.h"
+#include "timebase.h"
+#include "debug.h"
+
+typedef struct {
+	uint16_t period_ms;
+	uint16_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t window_start;
+} TELEMETRY_WINDOW_T;
+
+static TELEMETRY_WINDOW_T telemetry_windows[TELEMETRY_SIGNAL_COUNT];
+static uint8_t next_signal;
+
+static const char * const telemetry_signal_names[TELEMETRY_SIGNAL_COUNT] = {
+	"FRONT_RIGHT_WHEEL_SPEED",
+	"FRONT_LEFT_WHEEL_SPEED",
+	"RIGHT_ACCEL",
+	"LEFT_ACCEL",
+	"FRONT_BRAKE",
+	"REAR_BRAKE",
+	"STEERING",
+	"PACK_VOLTAGE",
+	"PACK_CURRENT",
+	"AVE_CELL_VOLTAGE",
+	"MIN_CELL_VOLTAGE",
+	"MAX_CELL_VOLTAGE"
+};
+
+static void reset_window(TELEMETRY_WINDOW_T * window) {
+	window->count = 0;
+	window->min = UINT32_MAX;
+	window->max = 0;
+	window->sum = 0;
+	window->window_start = msTicks;
+}
+
+void Telemetry_Init(void) {
+	uint8_t i;
+
+	for (i = 0; i < TELEMETRY_SIGNAL_COUNT; i++) {
+		telemetry_windows[i].period_ms = i < TELEMETRY_PACK_VOLTAGE ?
+			TELEMETRY_DEFAULT_FRONT_NODE_PERIOD_MS : TELEMETRY_DEFAULT_PACK_PERIOD_MS;
+		reset_window(&telemetry_windows[i]);
+	}
+	next_signal = 0;
+}
+
+void Telemetry_Sample(TELEMETRY_SIGNAL_T signal, uint32_t value) {
+	TELEMETRY_WINDOW_T * window = &telemetry_windows[signal];
+
+	// saturate rather than wrap if output is stalled for a long time
+	if (window->count == UINT16_MAX) {
+		return;
+	}
+
+	window->count++;
+	window->sum += value;
+	if (value < window->min) {
+		window->min = value;
+	}
+	if (value > window->max) {
+		window->max = value;
+	}
+}
+
+void Telemetry_Update(void) {
+	uint8_t checked;
+
+	for (checked = 0; checked < TELEMETRY_SIGNAL_COUNT; checked++) {
+		uint8_t signal = next_signal;
+		TELEMETRY_WINDOW_T * window = &telemetry_windows[signal];
+
+		next_signal = (next_signal + 1) % TELEMETRY_SIGNAL_COUNT;
+
+		if (window->period_ms == 0 || msTicks - window->window_start < window->period_ms) {
+			continue;
+		}
+		if (window->count == 0) {
+			window->window_start = msTicks;
+			continue;
+		}
+
+		DEBUG_Print(telemetry_signal_names[signal]);
+		DEBUG_Print(" n=");
+		DEBUG_PrintNumber(window->count, 10);
+		DEBUG_Print(" min=");
+		DEBUG_PrintNumber(window->min, 10);
+		DEBUG_Print(" max=");
+		DEBUG_PrintNumber(window->max, 10);
+		DEBUG_Print(" mean=");
+		DEBUG_PrintNumber(window->sum / window->count, 10);
+		DEBUG_Print("\r\n");
+
+		reset_window(window);
+		return;
+	}
+}
+
+void Telemetry_SetPeriod(TELEMETRY_SIGNAL_T signal, uint16_t period_ms) {
+	telemetry_windows[signal].period_ms = period_ms;
+	reset_window(&telemetry_windows[signal]);
+}
+
+uint16_t Telemetry_GetPeriod(TELEMETRY_SIGNAL_T signal) {
+	return telemetry_windows[signal].period_ms;
+}
+
+void Telemetry_PrintSignals(void) {
+	uint8_t i;
+
+	for (i = 0; i < TELEMETRY_SIGNAL_COUNT; i++) {
+		DEBUG_PrintNumber(i, 16);
+		DEBUG_Print(": ");
+		DEBUG_Print(telemetry_signal_names[i]);
+		DEBUG_Print(" every ");
+		DEBUG_PrintNumber(telemetry_windows[i].period_ms, 10);
+		DEBUG_Print(" ms\r\n");
+	}
+}
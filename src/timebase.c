@@ -0,0 +1,73 @@
+#include "timebase.h"
+#include "chip.h"
+
+/**
+ * @details reads msTicks and the SysTick current-value register as a pair
+ * that belongs to the same tick. In RAM with Timebase_GetCycles, which the
+ * CAN interrupt calls.
+ */
+RAMFUNC static void read_clock(uint32_t * ms, uint32_t * val) {
+	bool reload_pending;
+
+	// SysTick reloads and increments msTicks between the two reads if we
+	// are unlucky; read again until both values belong to the same tick
+	do {
+		*ms = msTicks;
+		*val = SysTick->VAL;
+		reload_pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+	} while (*ms != msTicks);
+
+	// from an interrupt handler SysTick_Handler can't run yet, so a reload
+	// after the msTicks read leaves msTicks one behind a value near LOAD
+	if (reload_pending && *val > SysTick->LOAD / 2) {
+		(*ms)++;
+	}
+}
+
+RAMFUNC uint32_t Timebase_GetCycles(void) {
+	uint32_t ms;
+	uint32_t val;
+
+	read_clock(&ms, &val);
+	return ms * (SysTick->LOAD + 1) + (SysTick->LOAD - val);
+}
+
+uint32_t Timebase_CyclesToMicros(uint32_t cycles) {
+	const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+	return cycles / cycles_per_us;
+}
+
+uint64_t Timebase_GetMicros(void) {
+	const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+	uint32_t ms;
+	uint32_t val;
+
+	read_clock(&ms, &val);
+	return (uint64_t) ms * 1000 + (SysTick->LOAD - val) / cycles_per_us;
+}
+
+uint64_t Timebase_MicrosAt(uint32_t cycles) {
+	const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+	uint32_t ms;
+	uint32_t val;
+	uint32_t now_cycles;
+
+	read_clock(&ms, &val);
+	now_cycles = ms * (SysTick->LOAD + 1) + (SysTick->LOAD - val);
+	return (uint64_t) ms * 1000 + (SysTick->LOAD - val) / cycles_per_us - (now_cycles - cycles) / cycles_per_us;
+}
+
+uint32_t Timebase_MillisAt(uint32_t cycles) {
+	uint32_t ms;
+	uint32_t val;
+	uint32_t into_tick;
+	uint32_t elapsed;
+
+	read_clock(&ms, &val);
+	into_tick = SysTick->LOAD - val;
+	elapsed = ms * (SysTick->LOAD + 1) + into_tick - cycles;
+	if (elapsed <= into_tick) {
+		return ms;
+	}
+	return ms - 1 - (elapsed - into_tick - 1) / (SysTick->LOAD + 1);
+}
@@ -0,0 +1,166 @@
+#include <string.h>
+#include "unity.h"
+#include "fault.h"
+#include "can_bus.h"
+#include "can_constants.h"
+#include "debug.h"
+
+/**
+ * Testing Strategy:
+ *
+ * Fault_Transmit with a FAULT_CORRUPT rule, the frame as it reaches the
+ * transmit queue
+ * - dlc
+ *   - 1, the VCU heartbeat
+ *   - 8
+ * - signal value
+ *   - all ones
+ *   - flips a set bit to 0
+ * - signal ends past the last byte of the frame
+ *   - frame sent unharmed, no fault counted
+ *
+ * The CAN transmit queue and the UART are stubbed below.
+ */
+
+volatile uint32_t msTicks;
+
+static uint32_t sent_mode_id;
+static uint8_t sent_dlc;
+static uint8_t sent_data[CAN_BUS_MAX_DLC];
+static uint32_t sent_frames;
+static uint32_t printed_bytes;
+
+bool CanBus_Transmit(uint32_t mode_id, const uint8_t * data, uint8_t dlc) {
+	sent_mode_id = mode_id;
+	sent_dlc = dlc;
+	memset(sent_data, 0, sizeof(sent_data));
+	memcpy(sent_data, data, dlc);
+	sent_frames++;
+	return true;
+}
+
+void Serial_Write(const void * data, uint32_t len) {
+	(void) data;
+	printed_bytes += len;
+}
+
+void DEBUG_PrintNumber(uint32_t value, uint8_t base) {
+	(void) value;
+	(void) base;
+}
+
+void Profile_Enter(PROFILE_REGION_T region) {
+	(void) region;
+}
+
+void Profile_Exit(PROFILE_REGION_T region) {
+	(void) region;
+}
+
+/**
+ * @details installs a rule that corrupts every frame with the id
+ */
+static void setCorruptRule(uint32_t mode_id, uint8_t signal_start, uint8_t signal_end, uint32_t signal_value) {
+	FAULT_RULE_T rule;
+
+	memset(&rule, 0, sizeof(rule));
+	rule.mode_id = mode_id;
+	rule.action = FAULT_CORRUPT;
+	rule.probability = 100;
+	rule.signal_start = signal_start;
+	rule.signal_end = signal_end;
+	rule.signal_value = signal_value;
+
+	Fault_Init();
+	sent_frames = 0;
+	printed_bytes = 0;
+	TEST_ASSERT_TRUE(Fault_SetRule(&rule));
+}
+
+/**
+ * Covers:
+ * Fault_Transmit
+ * - dlc 1, the VCU heartbeat
+ * - signal value all ones
+ */
+void test_Fault_Transmit_CorruptsOneByteFrame(void) {
+	uint8_t data = 0x1 << 7;
+
+	setCorruptRule(VCU_HEARTBEAT__id, __VCU_HEARTBEAT__STATE__start, __VCU_HEARTBEAT__STATE__end, 0x3);
+	TEST_ASSERT_TRUE(Fault_Transmit(VCU_HEARTBEAT__id, &data, 1));
+
+	TEST_ASSERT_EQUAL_INT(1, sent_frames);
+	TEST_ASSERT_EQUAL_INT(VCU_HEARTBEAT__id, sent_mode_id);
+	TEST_ASSERT_EQUAL_INT(1, sent_dlc);
+	TEST_ASSERT_EQUAL_INT(0xC0, sent_data[0]);
+
+	Fault_MarkDetected();
+	TEST_ASSERT_TRUE(printed_bytes > 0);
+}
+
+/**
+ * Covers:
+ * Fault_Transmit
+ * - dlc 1, the VCU heartbeat
+ * - signal value flips a set bit to 0
+ */
+void test_Fault_Transmit_ClearsBitOfOneByteFrame(void) {
+	uint8_t data = 0x1 << 7;
+
+	setCorruptRule(VCU_HEARTBEAT__id, __VCU_HEARTBEAT__STATE__start, __VCU_HEARTBEAT__STATE__end, ____VCU_HEARTBEAT__STATE__DISCHARGE);
+	Fault_Transmit(VCU_HEARTBEAT__id, &data, 1);
+
+	TEST_ASSERT_EQUAL_INT(1, sent_dlc);
+	TEST_ASSERT_EQUAL_INT(0x40, sent_data[0]);
+	// the caller's payload is left alone
+	TEST_ASSERT_EQUAL_INT(0x80, data);
+}
+
+/**
+ * Covers:
+ * Fault_Transmit
+ * - dlc 8
+ * - signal value all ones
+ */
+void test_Fault_Transmit_CorruptsEightByteFrame(void) {
+	const uint8_t data[8] = {0};
+	uint8_t i;
+
+	setCorruptRule(BMS_HEARTBEAT__id, 0, 3, 0xF);
+	Fault_Transmit(BMS_HEARTBEAT__id, data, 8);
+
+	TEST_ASSERT_EQUAL_INT(8, sent_dlc);
+	for (i = 0; i < 7; i++) {
+		TEST_ASSERT_EQUAL_INT(0, sent_data[i]);
+	}
+	TEST_ASSERT_EQUAL_INT(0xF0, sent_data[7]);
+}
+
+/**
+ * Covers:
+ * Fault_Transmit
+ * - signal ends past the last byte of the frame
+ */
+void test_Fault_Transmit_SignalBeyondDlcSentUnharmed(void) {
+	uint8_t data = 0x1 << 7;
+
+	setCorruptRule(VCU_HEARTBEAT__id, 6, 9, 0xF);
+	TEST_ASSERT_TRUE(Fault_Transmit(VCU_HEARTBEAT__id, &data, 1));
+
+	TEST_ASSERT_EQUAL_INT(1, sent_frames);
+	TEST_ASSERT_EQUAL_INT(1, sent_dlc);
+	TEST_ASSERT_EQUAL_INT(0x80, sent_data[0]);
+
+	// no fault was injected, so there is no detection to report
+	Fault_MarkDetected();
+	TEST_ASSERT_EQUAL_INT(0, printed_bytes);
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_Fault_Transmit_CorruptsOneByteFrame);
+	RUN_TEST(test_Fault_Transmit_ClearsBitOfOneByteFrame);
+	RUN_TEST(test_Fault_Transmit_CorruptsEightByteFrame);
+	RUN_TEST(test_Fault_Transmit_SignalBeyondDlcSentUnharmed);
+	return UNITY_END();
+}
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "can_utils.h"
+#include "can_constants.h"
+
+/**
+ * Differential fuzz harness for the decoders in can_utils.c.
+ *
+ * Every decoder is fed random payloads plus edge cases (all zeros, all
+ * ones, every single bit set and every single bit cleared) and its output
+ * is compared against a reference that rebuilds each signal one bit at a
+ * time from the bit numbering used in can_constants.h, where bit 0 is the
+ * most significant bit of data_64. Decode throughput is measured separately
+ * with the reference out of the loop.
+ *
+ * CAN_ExtractSignal is checked message by message, which covers the
+ * positions in CAN_Signals against can_constants.h as well.
+ *
+ * Usage: fuzz_can_utils [iterations per decoder] [seed]
+ */
+
+#define MAX_SIGNALS 8
+#define MAX_REPORTED_MISMATCHES 10
+
+typedef struct {
+	uint32_t start;
+	uint32_t end;
+	const char * name;
+} SIGNAL_T;
+
+typedef struct {
+	const char * name;
+	void (*decode)(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values);
+	uint32_t signal_count;
+	SIGNAL_T signals[MAX_SIGNALS];
+} DECODER_T;
+
+static void decode_bms_heartbeat(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	BMS_HEARTBEAT_T decoded;
+	CAN_MakeBMSHeartbeat(&decoded, msg_obj);
+	values[0] = decoded.state;
+	values[1] = decoded.soc_percentage;
+}
+
+static void decode_bms_discharge_response(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	BMS_DISCHARGE_RESPONSE_T decoded;
+	CAN_MakeBMSDischargeResponse(&decoded, msg_obj);
+	values[0] = decoded.discharge_response;
+}
+
+static void decode_wheel_speed(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	FRONT_CAN_NODE_WHEEL_SPEED_T decoded;
+	CAN_MakeFrontCanNodeWheelSpeed(&decoded, msg_obj);
+	values[0] = decoded.front_right_wheel_speed;
+	values[1] = decoded.front_left_wheel_speed;
+}
+
+static void decode_analog_sensors(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	FRONT_CAN_NODE_ANALOG_SENSORS_T decoded;
+	CAN_MakeFrontCanNodeAnalogSensors(&decoded, msg_obj);
+	values[0] = decoded.right_accel;
+	values[1] = decoded.left_accel;
+	values[2] = decoded.front_brake;
+	values[3] = decoded.rear_brake;
+	values[4] = decoded.steering;
+}
+
+static void decode_bms_pack_status(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	BMS_PACK_STATUS_T decoded;
+	CAN_MakeBMSPackStatus(&decoded, msg_obj);
+	values[0] = decoded.pack_voltage;
+	values[1] = decoded.pack_current;
+	values[2] = decoded.ave_cell_voltage;
+	values[3] = decoded.min_cell_voltage;
+	values[4] = decoded.min_cell_voltage_id;
+	values[5] = decoded.max_cell_voltage;
+	values[6] = decoded.max_cell_voltage_id;
+}
+
+static void decode_bms_cell_temps(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	BMS_CELL_TEMPS_T decoded;
+	CAN_MakeBMSCellTemps(&decoded, msg_obj);
+	values[0] = decoded.ave_cell_temp;
+	values[1] = decoded.min_cell_temp;
+	values[2] = decoded.min_cell_temp_id;
+	values[3] = decoded.max_cell_temp;
+	values[4] = decoded.max_cell_temp_id;
+}
+
+#define EXTRACT(message, signal) \
+	CAN_ExtractSignal(msg_obj, CAN_SIGNAL_##message##__##signal)
+
+static void extract_bms_heartbeat(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	values[0] = EXTRACT(BMS_HEARTBEAT, STATE);
+	values[1] = EXTRACT(BMS_HEARTBEAT, SOC_PERCENTAGE);
+}
+
+static void extract_bms_discharge_response(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	values[0] = EXTRACT(BMS_DISCHARGE_RESPONSE, DISCHARGE_RESPONSE);
+}
+
+static void extract_wheel_speed(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	values[0] = EXTRACT(FRONT_CAN_NODE_WHEEL_SPEED, FRONT_RIGHT_WHEEL_SPEED);
+	values[1] = EXTRACT(FRONT_CAN_NODE_WHEEL_SPEED, FRONT_LEFT_WHEEL_SPEED);
+}
+
+static void extract_analog_sensors(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	values[0] = EXTRACT(FRONT_CAN_NODE_ANALOG_SENSORS, RIGHT_ACCEL);
+	values[1] = EXTRACT(FRONT_CAN_NODE_ANALOG_SENSORS, LEFT_ACCEL);
+	values[2] = EXTRACT(FRONT_CAN_NODE_ANALOG_SENSORS, FRONT_BRAKE);
+	values[3] = EXTRACT(FRONT_CAN_NODE_ANALOG_SENSORS, REAR_BRAKE);
+	values[4] = EXTRACT(FRONT_CAN_NODE_ANALOG_SENSORS, STEERING);
+}
+
+static void extract_bms_pack_status(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	values[0] = EXTRACT(BMS_PACK_STATUS, PACK_VOLTAGE);
+	values[1] = EXTRACT(BMS_PACK_STATUS, PACK_CURRENT);
+	values[2] = EXTRACT(BMS_PACK_STATUS, AVE_CELL_VOLTAGE);
+	values[3] = EXTRACT(BMS_PACK_STATUS, MIN_CELL_VOLTAGE);
+	values[4] = EXTRACT(BMS_PACK_STATUS, MIN_CELL_VOLTAGE_ID);
+	values[5] = EXTRACT(BMS_PACK_STATUS, MAX_CELL_VOLTAGE);
+	values[6] = EXTRACT(BMS_PACK_STATUS, MAX_CELL_VOLTAGE_ID);
+}
+
+static void extract_bms_cell_temps(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	values[0] = EXTRACT(BMS_CELL_TEMPS, AVE_CELL_TEMP);
+	values[1] = EXTRACT(BMS_CELL_TEMPS, MIN_CELL_TEMP);
+	values[2] = EXTRACT(BMS_CELL_TEMPS, MIN_CELL_TEMP_ID);
+	values[3] = EXTRACT(BMS_CELL_TEMPS, MAX_CELL_TEMP);
+	values[4] = EXTRACT(BMS_CELL_TEMPS, MAX_CELL_TEMP_ID);
+}
+
+static void extract_bms_errors(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	values[0] = EXTRACT(BMS_ERRORS, CELL_UNDER_VOLTAGE_VALUE);
+	values[1] = EXTRACT(BMS_ERRORS, CELL_UNDER_VOLTAGE_ID);
+	values[2] = EXTRACT(BMS_ERRORS, CELL_OVER_VOLTAGE_VALUE);
+	values[3] = EXTRACT(BMS_ERRORS, CELL_OVER_VOLTAGE_ID);
+	values[4] = EXTRACT(BMS_ERRORS, CELL_OVER_TEMP_VALUE);
+	values[5] = EXTRACT(BMS_ERRORS, CELL_OVER_TEMP_ID);
+}
+
+static void extract_vcu_heartbeat(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	values[0] = EXTRACT(VCU_HEARTBEAT, STATE);
+}
+
+static void extract_vcu_discharge_request(CCAN_MSG_OBJ_T * msg_obj, uint64_t * values) {
+	values[0] = EXTRACT(VCU_DISCHARGE_REQUEST, DISCHARGE_REQUEST);
+}
+
+#define SIGNAL(message, signal) \
+	{ __##message##__##signal##__start, __##message##__##signal##__end, #signal }
+
+static const DECODER_T decoders[] = {
+	{ "CAN_MakeBMSHeartbeat", decode_bms_heartbeat, 2, {
+		SIGNAL(BMS_HEARTBEAT, STATE),
+		SIGNAL(BMS_HEARTBEAT, SOC_PERCENTAGE) } },
+	{ "CAN_MakeBMSDischargeResponse", decode_bms_discharge_response, 1, {
+		SIGNAL(BMS_DISCHARGE_RESPONSE, DISCHARGE_RESPONSE) } },
+	{ "CAN_MakeFrontCanNodeWheelSpeed", decode_wheel_speed, 2, {
+		SIGNAL(FRONT_CAN_NODE_WHEEL_SPEED, FRONT_RIGHT_WHEEL_SPEED),
+		SIGNAL(FRONT_CAN_NODE_WHEEL_SPEED, FRONT_LEFT_WHEEL_SPEED) } },
+	{ "CAN_MakeFrontCanNodeAnalogSensors", decode_analog_sensors, 5, {
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, RIGHT_ACCEL),
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, LEFT_ACCEL),
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, FRONT_BRAKE),
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, REAR_BRAKE),
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, STEERING) } },
+	{ "CAN_MakeBMSPackStatus", decode_bms_pack_status, 7, {
+		SIGNAL(BMS_PACK_STATUS, PACK_VOLTAGE),
+		SIGNAL(BMS_PACK_STATUS, PACK_CURRENT),
+		SIGNAL(BMS_PACK_STATUS, AVE_CELL_VOLTAGE),
+		SIGNAL(BMS_PACK_STATUS, MIN_CELL_VOLTAGE),
+		SIGNAL(BMS_PACK_STATUS, MIN_CELL_VOLTAGE_ID),
+		SIGNAL(BMS_PACK_STATUS, MAX_CELL_VOLTAGE),
+		SIGNAL(BMS_PACK_STATUS, MAX_CELL_VOLTAGE_ID) } },
+	{ "CAN_MakeBMSCellTemps", decode_bms_cell_temps, 5, {
+		SIGNAL(BMS_CELL_TEMPS, AVE_CELL_TEMP),
+		SIGNAL(BMS_CELL_TEMPS, MIN_CELL_TEMP),
+		SIGNAL(BMS_CELL_TEMPS, MIN_CELL_TEMP_ID),
+		SIGNAL(BMS_CELL_TEMPS, MAX_CELL_TEMP),
+		SIGNAL(BMS_CELL_TEMPS, MAX_CELL_TEMP_ID) } },
+	{ "CAN_ExtractSignal BMS_HEARTBEAT", extract_bms_heartbeat, 2, {
+		SIGNAL(BMS_HEARTBEAT, STATE),
+		SIGNAL(BMS_HEARTBEAT, SOC_PERCENTAGE) } },
+	{ "CAN_ExtractSignal BMS_DISCHARGE_RESPONSE", extract_bms_discharge_response, 1, {
+		SIGNAL(BMS_DISCHARGE_RESPONSE, DISCHARGE_RESPONSE) } },
+	{ "CAN_ExtractSignal FRONT_CAN_NODE_WHEEL_SPEED", extract_wheel_speed, 2, {
+		SIGNAL(FRONT_CAN_NODE_WHEEL_SPEED, FRONT_RIGHT_WHEEL_SPEED),
+		SIGNAL(FRONT_CAN_NODE_WHEEL_SPEED, FRONT_LEFT_WHEEL_SPEED) } },
+	{ "CAN_ExtractSignal FRONT_CAN_NODE_ANALOG_SENSORS", extract_analog_sensors, 5, {
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, RIGHT_ACCEL),
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, LEFT_ACCEL),
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, FRONT_BRAKE),
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, REAR_BRAKE),
+		SIGNAL(FRONT_CAN_NODE_ANALOG_SENSORS, STEERING) } },
+	{ "CAN_ExtractSignal BMS_PACK_STATUS", extract_bms_pack_status, 7, {
+		SIGNAL(BMS_PACK_STATUS, PACK_VOLTAGE),
+		SIGNAL(BMS_PACK_STATUS, PACK_CURRENT),
+		SIGNAL(BMS_PACK_STATUS, AVE_CELL_VOLTAGE),
+		SIGNAL(BMS_PACK_STATUS, MIN_CELL_VOLTAGE),
+		SIGNAL(BMS_PACK_STATUS, MIN_CELL_VOLTAGE_ID),
+		SIGNAL(BMS_PACK_STATUS, MAX_CELL_VOLTAGE),
+		SIGNAL(BMS_PACK_STATUS, MAX_CELL_VOLTAGE_ID) } },
+	{ "CAN_ExtractSignal BMS_CELL_TEMPS", extract_bms_cell_temps, 5, {
+		SIGNAL(BMS_CELL_TEMPS, AVE_CELL_TEMP),
+		SIGNAL(BMS_CELL_TEMPS, MIN_CELL_TEMP),
+		SIGNAL(BMS_CELL_TEMPS, MIN_CELL_TEMP_ID),
+		SIGNAL(BMS_CELL_TEMPS, MAX_CELL_TEMP),
+		SIGNAL(BMS_CELL_TEMPS, MAX_CELL_TEMP_ID) } },
+	{ "CAN_ExtractSignal BMS_ERRORS", extract_bms_errors, 6, {
+		SIGNAL(BMS_ERRORS, CELL_UNDER_VOLTAGE_VALUE),
+		SIGNAL(BMS_ERRORS, CELL_UNDER_VOLTAGE_ID),
+		SIGNAL(BMS_ERRORS, CELL_OVER_VOLTAGE_VALUE),
+		SIGNAL(BMS_ERRORS, CELL_OVER_VOLTAGE_ID),
+		SIGNAL(BMS_ERRORS, CELL_OVER_TEMP_VALUE),
+		SIGNAL(BMS_ERRORS, CELL_OVER_TEMP_ID) } },
+	{ "CAN_ExtractSignal VCU_HEARTBEAT", extract_vcu_heartbeat, 1, {
+		SIGNAL(VCU_HEARTBEAT, STATE) } },
+	{ "CAN_ExtractSignal VCU_DISCHARGE_REQUEST", extract_vcu_discharge_request, 1, {
+		SIGNAL(VCU_DISCHARGE_REQUEST, DISCHARGE_REQUEST) } }
+};
+
+#define DECODER_COUNT (sizeof(decoders) / sizeof(decoders[0]))
+
+/**
+ * @details slow reference: walks the signal one bit at a time
+ */
+static uint64_t reference_signal(uint64_t data_64, const SIGNAL_T * signal) {
+	const uint32_t CAN_message_highest_bit = 63;
+	uint64_t value = 0;
+	uint32_t bit;
+
+	for (bit = signal->start; bit <= signal->end; bit++) {
+		value = (value << 1) | ((data_64 >> (CAN_message_highest_bit - bit)) & 1);
+	}
+	return value;
+}
+
+static uint64_t rng_state;
+
+/**
+ * @details xorshift64*, deterministic for a given seed
+ */
+static uint64_t next_random(void) {
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 2685821657736338717ULL;
+}
+
+/**
+ * @details payload number i: the first 130 are edge cases, the rest random
+ */
+static uint64_t payload(uint64_t i) {
+	const uint64_t edge_cases = 2 + 64 + 64;
+
+	if (i == 0) {
+		return 0;
+	}
+	if (i == 1) {
+		return ~0ULL;
+	}
+	if (i < 2 + 64) {
+		return 1ULL << (i - 2);
+	}
+	if (i < edge_cases) {
+		return ~(1ULL << (i - 2 - 64));
+	}
+	return next_random();
+}
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @return number of mismatching payloads
+ */
+static uint64_t check_decoder(const DECODER_T * decoder, uint64_t iterations) {
+	CCAN_MSG_OBJ_T msg_obj;
+	uint64_t values[MAX_SIGNALS];
+	uint64_t mismatches = 0;
+	uint64_t i;
+	uint32_t s;
+
+	memset(&msg_obj, 0, sizeof(msg_obj));
+	msg_obj.dlc = 8;
+
+	for (i = 0; i < iterations; i++) {
+		msg_obj.data_64 = payload(i);
+		decoder->decode(&msg_obj, values);
+		for (s = 0; s < decoder->signal_count; s++) {
+			uint64_t expected = reference_signal(msg_obj.data_64, &decoder->signals[s]);
+			if (values[s] != expected) {
+				if (mismatches < MAX_REPORTED_MISMATCHES) {
+					printf("  MISMATCH %s.%s payload 0x%016llx: got 0x%llx expected 0x%llx\n",
+						decoder->name, decoder->signals[s].name,
+						(unsigned long long) msg_obj.data_64,
+						(unsigned long long) values[s], (unsigned long long) expected);
+				}
+				mismatches++;
+				break;
+			}
+		}
+	}
+	return mismatches;
+}
+
+/**
+ * @return decoded frames per second
+ */
+static double measure_throughput(const DECODER_T * decoder, uint64_t iterations) {
+	CCAN_MSG_OBJ_T msg_obj;
+	uint64_t values[MAX_SIGNALS];
+	volatile uint64_t sink = 0;
+	uint64_t i;
+	double start;
+	double elapsed;
+
+	memset(&msg_obj, 0, sizeof(msg_obj));
+	msg_obj.dlc = 8;
+
+	start = now_seconds();
+	for (i = 0; i < iterations; i++) {
+		msg_obj.data_64 = next_random();
+		decoder->decode(&msg_obj, values);
+		sink ^= values[0];
+	}
+	elapsed = now_seconds() - start;
+	return elapsed > 0 ? iterations / elapsed : 0;
+}
+
+int main(int argc, char ** argv) {
+	uint64_t iterations = argc > 1 ? strtoull(argv[1], NULL, 0) : 1000000;
+	uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x9E3779B97F4A7C15ULL;
+	uint64_t total_mismatches = 0;
+	uint32_t d;
+
+	printf("Fuzzing %u decoders, %llu payloads each, seed 0x%llx\n", (unsigned) DECODER_COUNT,
+		(unsigned long long) iterations, (unsigned long long) seed);
+
+	for (d = 0; d < DECODER_COUNT; d++) {
+		uint64_t mismatches;
+		double frames_per_second;
+
+		rng_state = seed ? seed : 1;
+		mismatches = check_decoder(&decoders[d], iterations);
+		frames_per_second = measure_throughput(&decoders[d], iterations);
+		printf("%-48s %10llu mismatches %12.0f frames/s\n", decoders[d].name,
+			(unsigned long long) mismatches, frames_per_second);
+		total_mismatches += mismatches;
+	}
+
+	return total_mismatches == 0 ? 0 : 1;
+}
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "unity.h"
 #include "can_utils.h"
 #include "can_constants.h"
@@ -17,6 +18,40 @@
  * - discharge_reponse
  *   - NOT_READY
  *   - READY
+ *
+ * CAN_MakeFrontCanNodeWheelSpeed
+ * - wheel speed bits
+ *   - contains a 1 on leftmost and rightmost side
+ *   - all bits set
+ *
+ * CAN_MakeFrontCanNodeAnalogSensors
+ * - sensor bits contain a 1 on leftmost and rightmost side
+ *
+ * CAN_MakeBMSPackStatus
+ * - signal bits contain a 1 on leftmost and rightmost side
+ *
+ * CAN_MakeBMSCellTemps
+ * - signal bits contain a 1 on leftmost and rightmost side
+ *
+ * CAN_EncodeBMSHeartbeat, CAN_EncodeBMSDischargeResponse,
+ * CAN_EncodeBMSPackStatus, CAN_EncodeBMSCellTemps
+ * - decoding the encoded message gives back every signal
+ *   - signals at their largest value
+ *   - signals with a 1 on leftmost and rightmost side
+ * - values wider than their signal don't spill into neighbouring signals
+ *
+ * CAN_Signals, CAN_ExtractSignal
+ * - descriptors fit in 64 bits and 32 bit values
+ * - signals of a message are listed next to each other
+ * - extracted values match the CAN_Make functions
+ *
+ * CAN_ExtractSignal, CAN_SignalInFrame, CAN_InsertSignal, CAN_Make functions
+ * - dlc
+ *   - 8
+ *   - less than 8, bit 0 is the most significant bit of data[dlc - 1]
+ * - signal
+ *   - within the frame
+ *   - ends past the frame
  */
 
 /**
@@ -28,6 +63,7 @@
  */
 void constructBMSHeartbeatCANMessageObject(uint64_t state, uint64_t soc_percentage, CCAN_MSG_OBJ_T * msg_obj) {
 	msg_obj->mode_id = BMS_HEARTBEAT__id;
+	msg_obj->dlc = 8;
 	const uint32_t CAN_message_max_bit = 63;
         msg_obj->data_64 = 0 |
                 (state << (CAN_message_max_bit - __BMS_HEARTBEAT__STATE__end)) |		(soc_percentage << (CAN_message_max_bit - __BMS_HEARTBEAT__SOC_PERCENTAGE__end));
@@ -87,6 +123,7 @@ void test_CAN_MakeBMSHeartbeat_OneBitsLeftmostAndRightmostSide(void) {
  */
 void constructDischargeResponseCANMessageObject(uint64_t discharge_response, CCAN_MSG_OBJ_T * msg_obj) {
         msg_obj->mode_id = BMS_DISCHARGE_RESPONSE__id;
+        msg_obj->dlc = 8;
         const uint32_t CAN_message_max_bit = 63;
         msg_obj->data_64 = 0 |
                 (discharge_response << (CAN_message_max_bit - __BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__end));
@@ -128,6 +165,397 @@ void test_CAN_MakeBMSDischargeResponse_NotReady(void) {
         TEST_ASSERT_EQUAL_INT(expected_discharge_response, bms_discharge_response.discharge_response);
 }
 
+/**
+ * @details constructs a CAN message object from a list of signal values
+ *
+ * @param mode_id CAN message id
+ * @param ends end bit of each signal
+ * @param values value of each signal
+ * @param count number of signals
+ * @param msg_obj CAN message object that is mutated to represent the inputs
+ */
+void constructCANMessageObject(uint32_t mode_id, const uint32_t * ends, const uint64_t * values,
+		uint32_t count, CCAN_MSG_OBJ_T * msg_obj) {
+	const uint32_t CAN_message_max_bit = 63;
+	uint32_t i;
+
+	msg_obj->mode_id = mode_id;
+	msg_obj->dlc = 8;
+	msg_obj->data_64 = 0;
+	for (i = 0; i < count; i++) {
+		msg_obj->data_64 |= values[i] << (CAN_message_max_bit - ends[i]);
+	}
+}
+
+/**
+ * Covers:
+ * CAN_MakeFrontCanNodeWheelSpeed
+ * - wheel speed bits
+ *   - contains a 1 on leftmost and rightmost side
+ */
+void test_CAN_MakeFrontCanNodeWheelSpeed_OneBitsLeftmostAndRightmostSide(void) {
+	const uint32_t ends[] = {
+		__FRONT_CAN_NODE_WHEEL_SPEED__FRONT_RIGHT_WHEEL_SPEED__end,
+		__FRONT_CAN_NODE_WHEEL_SPEED__FRONT_LEFT_WHEEL_SPEED__end
+	};
+	const uint64_t values[] = {0x80000001, 0x80000003};
+
+	CCAN_MSG_OBJ_T msg_obj;
+	constructCANMessageObject(FRONT_CAN_NODE_WHEEL_SPEED__id, ends, values, 2, &msg_obj);
+
+	FRONT_CAN_NODE_WHEEL_SPEED_T wheel_speed;
+	CAN_MakeFrontCanNodeWheelSpeed(&wheel_speed, &msg_obj);
+
+	TEST_ASSERT_EQUAL_UINT32(values[0], wheel_speed.front_right_wheel_speed);
+	TEST_ASSERT_EQUAL_UINT32(values[1], wheel_speed.front_left_wheel_speed);
+}
+
+/**
+ * Covers:
+ * CAN_MakeFrontCanNodeWheelSpeed
+ * - wheel speed bits
+ *   - all bits set
+ */
+void test_CAN_MakeFrontCanNodeWheelSpeed_AllBitsSet(void) {
+	CCAN_MSG_OBJ_T msg_obj;
+	msg_obj.mode_id = FRONT_CAN_NODE_WHEEL_SPEED__id;
+	msg_obj.dlc = 8;
+	msg_obj.data_64 = ~0ULL;
+
+	FRONT_CAN_NODE_WHEEL_SPEED_T wheel_speed;
+	CAN_MakeFrontCanNodeWheelSpeed(&wheel_speed, &msg_obj);
+
+	TEST_ASSERT_EQUAL_UINT32(____FRONT_CAN_NODE_WHEEL_SPEED__FRONT_RIGHT_WHEEL_SPEED__FRONT_RIGHT_WHEEL_SPEED__TO,
+		wheel_speed.front_right_wheel_speed);
+	TEST_ASSERT_EQUAL_UINT32(____FRONT_CAN_NODE_WHEEL_SPEED__FRONT_LEFT_WHEEL_SPEED__FRONT_LEFT_WHEEL_SPEED__TO,
+		wheel_speed.front_left_wheel_speed);
+}
+
+/**
+ * Covers:
+ * CAN_MakeFrontCanNodeAnalogSensors
+ * - sensor bits contain a 1 on leftmost and rightmost side
+ */
+void test_CAN_MakeFrontCanNodeAnalogSensors_OneBitsLeftmostAndRightmostSide(void) {
+	const uint32_t ends[] = {
+		__FRONT_CAN_NODE_ANALOG_SENSORS__RIGHT_ACCEL__end,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__LEFT_ACCEL__end,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__FRONT_BRAKE__end,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__REAR_BRAKE__end,
+		__FRONT_CAN_NODE_ANALOG_SENSORS__STEERING__end
+	};
+	const uint64_t values[] = {0x81, 0x83, 0x85, 0x87, 0x89};
+
+	CCAN_MSG_OBJ_T msg_obj;
+	constructCANMessageObject(FRONT_CAN_NODE_ANALOG_SENSORS__id, ends, values, 5, &msg_obj);
+
+	FRONT_CAN_NODE_ANALOG_SENSORS_T analog_sensors;
+	CAN_MakeFrontCanNodeAnalogSensors(&analog_sensors, &msg_obj);
+
+	TEST_ASSERT_EQUAL_INT(values[0], analog_sensors.right_accel);
+	TEST_ASSERT_EQUAL_INT(values[1], analog_sensors.left_accel);
+	TEST_ASSERT_EQUAL_INT(values[2], analog_sensors.front_brake);
+	TEST_ASSERT_EQUAL_INT(values[3], analog_sensors.rear_brake);
+	TEST_ASSERT_EQUAL_INT(values[4], analog_sensors.steering);
+}
+
+/**
+ * Covers:
+ * CAN_MakeBMSPackStatus
+ * - signal bits contain a 1 on leftmost and rightmost side
+ */
+void test_CAN_MakeBMSPackStatus_OneBitsLeftmostAndRightmostSide(void) {
+	const uint32_t ends[] = {
+		__BMS_PACK_STATUS__PACK_VOLTAGE__end,
+		__BMS_PACK_STATUS__PACK_CURRENT__end,
+		__BMS_PACK_STATUS__AVE_CELL_VOLTAGE__end,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE__end,
+		__BMS_PACK_STATUS__MIN_CELL_VOLTAGE_ID__end,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE__end,
+		__BMS_PACK_STATUS__MAX_CELL_VOLTAGE_ID__end
+	};
+	const uint64_t values[] = {0x201, 0x203, 0x205, 0x207, 0x41, 0x209, 0x43};
+
+	CCAN_MSG_OBJ_T msg_obj;
+	constructCANMessageObject(BMS_PACK_STATUS__id, ends, values, 7, &msg_obj);
+
+	BMS_PACK_STATUS_T bms_pack_status;
+	CAN_MakeBMSPackStatus(&bms_pack_status, &msg_obj);
+
+	TEST_ASSERT_EQUAL_INT(values[0], bms_pack_status.pack_voltage);
+	TEST_ASSERT_EQUAL_INT(values[1], bms_pack_status.pack_current);
+	TEST_ASSERT_EQUAL_INT(values[2], bms_pack_status.ave_cell_voltage);
+	TEST_ASSERT_EQUAL_INT(values[3], bms_pack_status.min_cell_voltage);
+	TEST_ASSERT_EQUAL_INT(values[4], bms_pack_status.min_cell_voltage_id);
+	TEST_ASSERT_EQUAL_INT(values[5], bms_pack_status.max_cell_voltage);
+	TEST_ASSERT_EQUAL_INT(values[6], bms_pack_status.max_cell_voltage_id);
+}
+
+/**
+ * Covers:
+ * CAN_MakeBMSCellTemps
+ * - signal bits contain a 1 on leftmost and rightmost side
+ */
+void test_CAN_MakeBMSCellTemps_OneBitsLeftmostAndRightmostSide(void) {
+	const uint32_t ends[] = {
+		__BMS_CELL_TEMPS__AVE_CELL_TEMP__end,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP__end,
+		__BMS_CELL_TEMPS__MIN_CELL_TEMP_ID__end,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP__end,
+		__BMS_CELL_TEMPS__MAX_CELL_TEMP_ID__end
+	};
+	const uint64_t values[] = {0x81, 0x83, 0x85, 0x87, 0x89};
+
+	CCAN_MSG_OBJ_T msg_obj;
+	constructCANMessageObject(BMS_CELL_TEMPS__id, ends, values, 5, &msg_obj);
+
+	BMS_CELL_TEMPS_T bms_cell_temps;
+	CAN_MakeBMSCellTemps(&bms_cell_temps, &msg_obj);
+
+	TEST_ASSERT_EQUAL_INT(values[0], bms_cell_temps.ave_cell_temp);
+	TEST_ASSERT_EQUAL_INT(values[1], bms_cell_temps.min_cell_temp);
+	TEST_ASSERT_EQUAL_INT(values[2], bms_cell_temps.min_cell_temp_id);
+	TEST_ASSERT_EQUAL_INT(values[3], bms_cell_temps.max_cell_temp);
+	TEST_ASSERT_EQUAL_INT(values[4], bms_cell_temps.max_cell_temp_id);
+}
+
+/**
+ * Covers:
+ * CAN_EncodeBMSHeartbeat
+ * - decoding the encoded message gives back every signal
+ *   - signals at their largest value
+ *   - signals with a 1 on leftmost and rightmost side
+ */
+void test_CAN_EncodeBMSHeartbeat_RoundTrip(void) {
+	BMS_HEARTBEAT_T expected = {____BMS_HEARTBEAT__STATE__ERROR, 0b1000000001};
+	BMS_HEARTBEAT_T largest = {0x7, ____BMS_HEARTBEAT__SOC_PERCENTAGE__SOC_PERCENTAGE__TO};
+	BMS_HEARTBEAT_T actual;
+	CCAN_MSG_OBJ_T msg_obj;
+
+	CAN_EncodeBMSHeartbeat(&msg_obj, &expected);
+	TEST_ASSERT_EQUAL_UINT32(BMS_HEARTBEAT__id, msg_obj.mode_id);
+	TEST_ASSERT_EQUAL_INT(8, msg_obj.dlc);
+	CAN_MakeBMSHeartbeat(&actual, &msg_obj);
+	TEST_ASSERT_EQUAL_INT(expected.state, actual.state);
+	TEST_ASSERT_EQUAL_INT(expected.soc_percentage, actual.soc_percentage);
+
+	CAN_EncodeBMSHeartbeat(&msg_obj, &largest);
+	CAN_MakeBMSHeartbeat(&actual, &msg_obj);
+	TEST_ASSERT_EQUAL_INT(largest.state, actual.state);
+	TEST_ASSERT_EQUAL_INT(largest.soc_percentage, actual.soc_percentage);
+}
+
+/**
+ * Covers:
+ * CAN_EncodeBMSDischargeResponse
+ * - decoding the encoded message gives back every signal
+ */
+void test_CAN_EncodeBMSDischargeResponse_RoundTrip(void) {
+	BMS_DISCHARGE_RESPONSE_T ready = {____BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__READY};
+	BMS_DISCHARGE_RESPONSE_T not_ready = {____BMS_DISCHARGE_RESPONSE__DISCHARGE_RESPONSE__NOT_READY};
+	BMS_DISCHARGE_RESPONSE_T actual;
+	CCAN_MSG_OBJ_T msg_obj;
+
+	CAN_EncodeBMSDischargeResponse(&msg_obj, &ready);
+	TEST_ASSERT_EQUAL_UINT32(BMS_DISCHARGE_RESPONSE__id, msg_obj.mode_id);
+	CAN_MakeBMSDischargeResponse(&actual, &msg_obj);
+	TEST_ASSERT_EQUAL_INT(ready.discharge_response, actual.discharge_response);
+
+	CAN_EncodeBMSDischargeResponse(&msg_obj, &not_ready);
+	CAN_MakeBMSDischargeResponse(&actual, &msg_obj);
+	TEST_ASSERT_EQUAL_INT(not_ready.discharge_response, actual.discharge_response);
+}
+
+/**
+ * Covers:
+ * CAN_EncodeBMSPackStatus
+ * - decoding the encoded message gives back every signal
+ *   - signals with a 1 on leftmost and rightmost side
+ * - values wider than their signal don't spill into neighbouring signals
+ */
+void test_CAN_EncodeBMSPackStatus_RoundTrip(void) {
+	BMS_PACK_STATUS_T expected = {0x201, 0x203, 0x205, 0x207, 0x41, 0x209, 0x43};
+	BMS_PACK_STATUS_T overflow = {0xFFFF, 0, 0xFFFF, 0, 0xFF, 0, 0xFF};
+	BMS_PACK_STATUS_T actual;
+	CCAN_MSG_OBJ_T msg_obj;
+
+	CAN_EncodeBMSPackStatus(&msg_obj, &expected);
+	TEST_ASSERT_EQUAL_UINT32(BMS_PACK_STATUS__id, msg_obj.mode_id);
+	CAN_MakeBMSPackStatus(&actual, &msg_obj);
+	TEST_ASSERT_EQUAL_INT(expected.pack_voltage, actual.pack_voltage);
+	TEST_ASSERT_EQUAL_INT(expected.pack_current, actual.pack_current);
+	TEST_ASSERT_EQUAL_INT(expected.ave_cell_voltage, actual.ave_cell_voltage);
+	TEST_ASSERT_EQUAL_INT(expected.min_cell_voltage, actual.min_cell_voltage);
+	TEST_ASSERT_EQUAL_INT(expected.min_cell_voltage_id, actual.min_cell_voltage_id);
+	TEST_ASSERT_EQUAL_INT(expected.max_cell_voltage, actual.max_cell_voltage);
+	TEST_ASSERT_EQUAL_INT(expected.max_cell_voltage_id, actual.max_cell_voltage_id);
+
+	CAN_EncodeBMSPackStatus(&msg_obj, &overflow);
+	CAN_MakeBMSPackStatus(&actual, &msg_obj);
+	TEST_ASSERT_EQUAL_INT(____BMS_PACK_STATUS__PACK_VOLTAGE__PACK_VOLTAGE__TO, actual.pack_voltage);
+	TEST_ASSERT_EQUAL_INT(0, actual.pack_current);
+	TEST_ASSERT_EQUAL_INT(____BMS_PACK_STATUS__AVE_CELL_VOLTAGE__AVE_CELL_VOLTAGE__TO, actual.ave_cell_voltage);
+	TEST_ASSERT_EQUAL_INT(0, actual.min_cell_voltage);
+	TEST_ASSERT_EQUAL_INT(____BMS_PACK_STATUS__MIN_CELL_VOLTAGE_ID__MIN_CELL_VOLTAGE_ID__TO, actual.min_cell_voltage_id);
+	TEST_ASSERT_EQUAL_INT(0, actual.max_cell_voltage);
+	TEST_ASSERT_EQUAL_INT(____BMS_PACK_STATUS__MAX_CELL_VOLTAGE_ID__MAX_CELL_VOLTAGE_ID__TO, actual.max_cell_voltage_id);
+}
+
+/**
+ * Covers:
+ * CAN_EncodeBMSCellTemps
+ * - decoding the encoded message gives back every signal
+ *   - signals at their largest value
+ */
+void test_CAN_EncodeBMSCellTemps_RoundTrip(void) {
+	BMS_CELL_TEMPS_T expected = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	BMS_CELL_TEMPS_T actual;
+	CCAN_MSG_OBJ_T msg_obj;
+
+	CAN_EncodeBMSCellTemps(&msg_obj, &expected);
+	TEST_ASSERT_EQUAL_UINT32(BMS_CELL_TEMPS__id, msg_obj.mode_id);
+	CAN_MakeBMSCellTemps(&actual, &msg_obj);
+	TEST_ASSERT_EQUAL_INT(expected.ave_cell_temp, actual.ave_cell_temp);
+	TEST_ASSERT_EQUAL_INT(expected.min_cell_temp, actual.min_cell_temp);
+	TEST_ASSERT_EQUAL_INT(expected.min_cell_temp_id, actual.min_cell_temp_id);
+	TEST_ASSERT_EQUAL_INT(expected.max_cell_temp, actual.max_cell_temp);
+	TEST_ASSERT_EQUAL_INT(expected.max_cell_temp_id, actual.max_cell_temp_id);
+}
+
+/**
+ * Covers:
+ * CAN_Signals
+ * - descriptors fit in 64 bits and 32 bit values
+ * - signals of a message are listed next to each other
+ */
+void test_CAN_Signals_Layout(void) {
+	uint32_t i;
+	uint32_t j;
+
+	for (i = 0; i < CAN_SIGNAL_COUNT; i++) {
+		TEST_ASSERT_TRUE(CAN_Signals[i].start <= CAN_Signals[i].end);
+		TEST_ASSERT_TRUE(CAN_Signals[i].end <= 63);
+		TEST_ASSERT_TRUE(CAN_Signals[i].end - CAN_Signals[i].start < 32);
+		for (j = i + 2; j < CAN_SIGNAL_COUNT; j++) {
+			if (CAN_Signals[j].id == CAN_Signals[i].id) {
+				TEST_ASSERT_EQUAL_UINT32(CAN_Signals[i].id, CAN_Signals[j - 1].id);
+			}
+		}
+	}
+}
+
+/**
+ * Covers:
+ * CAN_ExtractSignal
+ * - extracted values match the CAN_Make functions
+ */
+void test_CAN_ExtractSignal_MatchesMake(void) {
+	BMS_PACK_STATUS_T pack_status = {0x201, 0x203, 0x205, 0x207, 0x41, 0x209, 0x43};
+	CCAN_MSG_OBJ_T msg_obj;
+
+	CAN_EncodeBMSPackStatus(&msg_obj, &pack_status);
+	TEST_ASSERT_EQUAL_UINT32(BMS_PACK_STATUS__id, CAN_Signals[CAN_SIGNAL_BMS_PACK_STATUS__PACK_VOLTAGE].id);
+	TEST_ASSERT_EQUAL_UINT32(pack_status.pack_voltage, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_PACK_STATUS__PACK_VOLTAGE));
+	TEST_ASSERT_EQUAL_UINT32(pack_status.pack_current, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_PACK_STATUS__PACK_CURRENT));
+	TEST_ASSERT_EQUAL_UINT32(pack_status.ave_cell_voltage, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_PACK_STATUS__AVE_CELL_VOLTAGE));
+	TEST_ASSERT_EQUAL_UINT32(pack_status.min_cell_voltage, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_PACK_STATUS__MIN_CELL_VOLTAGE));
+	TEST_ASSERT_EQUAL_UINT32(pack_status.min_cell_voltage_id, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_PACK_STATUS__MIN_CELL_VOLTAGE_ID));
+	TEST_ASSERT_EQUAL_UINT32(pack_status.max_cell_voltage, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_PACK_STATUS__MAX_CELL_VOLTAGE));
+	TEST_ASSERT_EQUAL_UINT32(pack_status.max_cell_voltage_id, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_PACK_STATUS__MAX_CELL_VOLTAGE_ID));
+
+	constructBMSHeartbeatCANMessageObject(____BMS_HEARTBEAT__STATE__ERROR, 0x3FF, &msg_obj);
+	TEST_ASSERT_EQUAL_UINT32(____BMS_HEARTBEAT__STATE__ERROR, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_HEARTBEAT__STATE));
+	TEST_ASSERT_EQUAL_UINT32(0x3FF, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_HEARTBEAT__SOC_PERCENTAGE));
+}
+
+/**
+ * Covers:
+ * CAN_ExtractSignal, CAN_SignalInFrame, CAN_Make functions
+ * - dlc less than 8
+ * - signal within the frame
+ * - signal ends past the frame
+ */
+void test_CAN_ExtractSignal_ShortFrame(void) {
+	CCAN_MSG_OBJ_T short_frame;
+	CCAN_MSG_OBJ_T long_frame;
+	FRONT_CAN_NODE_WHEEL_SPEED_T short_speed;
+	FRONT_CAN_NODE_WHEEL_SPEED_T long_speed;
+
+	// the tester's own VCU heartbeat, 050#80 and 050#40
+	short_frame.mode_id = VCU_HEARTBEAT__id;
+	short_frame.dlc = 1;
+	short_frame.data_64 = 0;
+	short_frame.data[0] = 0x80;
+	TEST_ASSERT_EQUAL_UINT32(2, CAN_ExtractSignal(&short_frame, CAN_SIGNAL_VCU_HEARTBEAT__STATE));
+	short_frame.data[0] = 0x40;
+	TEST_ASSERT_EQUAL_UINT32(____VCU_HEARTBEAT__STATE__DISCHARGE, CAN_ExtractSignal(&short_frame, CAN_SIGNAL_VCU_HEARTBEAT__STATE));
+	// bytes past the dlc are ignored
+	short_frame.data[7] = 0xFF;
+	TEST_ASSERT_EQUAL_UINT32(____VCU_HEARTBEAT__STATE__DISCHARGE, CAN_ExtractSignal(&short_frame, CAN_SIGNAL_VCU_HEARTBEAT__STATE));
+
+	TEST_ASSERT_TRUE(CAN_SignalInFrame(CAN_SIGNAL_VCU_HEARTBEAT__STATE, 1));
+	TEST_ASSERT_FALSE(CAN_SignalInFrame(CAN_SIGNAL_VCU_HEARTBEAT__STATE, 0));
+	TEST_ASSERT_FALSE(CAN_SignalInFrame(CAN_SIGNAL_BMS_PACK_STATUS__PACK_VOLTAGE, 1));
+	TEST_ASSERT_TRUE(CAN_SignalInFrame(CAN_SIGNAL_BMS_PACK_STATUS__PACK_VOLTAGE, 2));
+	TEST_ASSERT_TRUE(CAN_SignalInFrame(CAN_SIGNAL_BMS_PACK_STATUS__MAX_CELL_VOLTAGE_ID, 8));
+
+	// a 4 byte payload reads as the last 4 bytes of an 8 byte one
+	short_frame.mode_id = FRONT_CAN_NODE_WHEEL_SPEED__id;
+	short_frame.dlc = 4;
+	short_frame.data[0] = 0x12;
+	short_frame.data[1] = 0x34;
+	short_frame.data[2] = 0x56;
+	short_frame.data[3] = 0x78;
+	long_frame.mode_id = FRONT_CAN_NODE_WHEEL_SPEED__id;
+	long_frame.dlc = 8;
+	long_frame.data_64 = 0;
+	long_frame.data[4] = 0x12;
+	long_frame.data[5] = 0x34;
+	long_frame.data[6] = 0x56;
+	long_frame.data[7] = 0x78;
+	CAN_MakeFrontCanNodeWheelSpeed(&short_speed, &short_frame);
+	CAN_MakeFrontCanNodeWheelSpeed(&long_speed, &long_frame);
+	TEST_ASSERT_EQUAL_UINT32(long_speed.front_right_wheel_speed, short_speed.front_right_wheel_speed);
+	TEST_ASSERT_EQUAL_UINT32(long_speed.front_right_wheel_speed,
+		CAN_ExtractSignal(&short_frame, CAN_SIGNAL_FRONT_CAN_NODE_WHEEL_SPEED__FRONT_RIGHT_WHEEL_SPEED));
+}
+
+/**
+ * Covers:
+ * CAN_InsertSignal
+ * - dlc 8
+ * - dlc less than 8
+ * - signal ends past the frame
+ */
+void test_CAN_InsertSignal_ShortFrame(void) {
+	uint8_t heartbeat[8] = {0x80};
+	uint8_t payload[8] = {0};
+	CCAN_MSG_OBJ_T msg_obj;
+	uint8_t i;
+
+	TEST_ASSERT_TRUE(CAN_InsertSignal(heartbeat, 1, __VCU_HEARTBEAT__STATE__start, __VCU_HEARTBEAT__STATE__end, 0x3));
+	TEST_ASSERT_EQUAL_INT(0xC0, heartbeat[0]);
+	TEST_ASSERT_TRUE(CAN_InsertSignal(heartbeat, 1, __VCU_HEARTBEAT__STATE__start, __VCU_HEARTBEAT__STATE__end, ____VCU_HEARTBEAT__STATE__DISCHARGE));
+	TEST_ASSERT_EQUAL_INT(0x40, heartbeat[0]);
+
+	TEST_ASSERT_FALSE(CAN_InsertSignal(heartbeat, 1, 6, 9, 0xF));
+	TEST_ASSERT_EQUAL_INT(0x40, heartbeat[0]);
+	TEST_ASSERT_EQUAL_INT(0, heartbeat[1]);
+
+	TEST_ASSERT_TRUE(CAN_InsertSignal(payload, 8, 0, 3, 0xF));
+	for (i = 0; i < 7; i++) {
+		TEST_ASSERT_EQUAL_INT(0, payload[i]);
+	}
+	TEST_ASSERT_EQUAL_INT(0xF0, payload[7]);
+
+	// decoding gives back what was inserted
+	memset(payload, 0, sizeof(payload));
+	TEST_ASSERT_TRUE(CAN_InsertSignal(payload, 2, __BMS_PACK_STATUS__PACK_VOLTAGE__start, __BMS_PACK_STATUS__PACK_VOLTAGE__end, 0x201));
+	msg_obj.mode_id = BMS_PACK_STATUS__id;
+	msg_obj.dlc = 2;
+	memcpy(msg_obj.data, payload, sizeof(payload));
+	TEST_ASSERT_EQUAL_UINT32(0x201, CAN_ExtractSignal(&msg_obj, CAN_SIGNAL_BMS_PACK_STATUS__PACK_VOLTAGE));
+}
 
 int main(void) {
 	UNITY_BEGIN();
@@ -135,6 +563,19 @@ int main(void) {
 	RUN_TEST(test_CAN_MakeBMSHeartbeat_OneBitsLeftmostAndRightmostSide);
 	RUN_TEST(test_CAN_MakeBMSDischargeResponse_Ready);
 	RUN_TEST(test_CAN_MakeBMSDischargeResponse_NotReady);
+	RUN_TEST(test_CAN_MakeFrontCanNodeWheelSpeed_OneBitsLeftmostAndRightmostSide);
+	RUN_TEST(test_CAN_MakeFrontCanNodeWheelSpeed_AllBitsSet);
+	RUN_TEST(test_CAN_MakeFrontCanNodeAnalogSensors_OneBitsLeftmostAndRightmostSide);
+	RUN_TEST(test_CAN_MakeBMSPackStatus_OneBitsLeftmostAndRightmostSide);
+	RUN_TEST(test_CAN_MakeBMSCellTemps_OneBitsLeftmostAndRightmostSide);
+	RUN_TEST(test_CAN_EncodeBMSHeartbeat_RoundTrip);
+	RUN_TEST(test_CAN_EncodeBMSDischargeResponse_RoundTrip);
+	RUN_TEST(test_CAN_EncodeBMSPackStatus_RoundTrip);
+	RUN_TEST(test_CAN_EncodeBMSCellTemps_RoundTrip);
+	RUN_TEST(test_CAN_Signals_Layout);
+	RUN_TEST(test_CAN_ExtractSignal_MatchesMake);
+	RUN_TEST(test_CAN_ExtractSignal_ShortFrame);
+	RUN_TEST(test_CAN_InsertSignal_ShortFrame);
 	return UNITY_END();
 }
 
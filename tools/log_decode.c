@@ -0,0 +1,461 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "can_utils.h"
+#include "can_constants.h"
+
+/**
+ * Offline decoder for candump logs, built on the host with can_utils.c
+ * (make log_decode), so a frame decodes to the same values as in the
+ * firmware's signal table (signal_db.h), short frames included.
+ *
+ * Usage: log_decode [-j threads] [-b] [-o directory] LOGFILE
+ *
+ * Reads logs in the candump -l format, one frame per line:
+ *
+ *   (1436509052.249713) can0 6F1#02A0000000000000
+ *
+ * and writes one output per signal of CAN_SIGNALS in can_utils.h, named
+ * MESSAGE.SIGNAL as in can_constants.h, for every signal that occurs:
+ *
+ *   MESSAGE.SIGNAL.csv     time,value lines, time in seconds (default)
+ *   MESSAGE.SIGNAL.time    -b: int64 microseconds, host byte order
+ *   MESSAGE.SIGNAL.value   -b: uint32 raw values, host byte order
+ *
+ * The binary columns load directly with numpy.fromfile. Extended, remote
+ * and CAN FD frames, ids without signals and malformed lines are skipped,
+ * as are signals that end past the frame's dlc (see can_utils.h).
+ *
+ * The log is memory mapped and decoded in chunks split at line boundaries,
+ * one chunk per thread (default: every online core). Chunks are decoded
+ * into memory and appended to the outputs in file order, a round of
+ * chunks at a time, so memory use stays bounded however large the log.
+ */
+
+#define CHUNK_BYTES (32UL << 20)
+#define MAX_THREADS 64
+#define STANDARD_ID_COUNT 0x800
+#define MAX_DLC 8
+#define MICROS_PER_SECOND 1000000LL
+// longest CSV line: 20 digit seconds, point, 6 digits, comma, 10 digits, newline
+#define MAX_CSV_LINE 40
+
+typedef enum {
+	COLUMN_CSV,
+	COLUMN_TIME = COLUMN_CSV,
+	COLUMN_VALUE,
+	COLUMN_COUNT
+} COLUMN_T;
+
+typedef struct {
+	char * data;
+	size_t length;
+	size_t capacity;
+} BUFFER_T;
+
+typedef struct {
+	const char * start;
+	const char * end;
+	unsigned long frames;
+	unsigned long decoded;
+	unsigned long skipped;
+	BUFFER_T columns[CAN_SIGNAL_COUNT][COLUMN_COUNT];
+} CHUNK_T;
+
+static const char * const signal_names[CAN_SIGNAL_COUNT] = {
+#define CAN_SIGNAL_NAME(message, signal) #message "." #signal,
+	CAN_SIGNALS(CAN_SIGNAL_NAME)
+#undef CAN_SIGNAL_NAME
+};
+
+// signals of each standard id, contiguous since CAN_SIGNALS groups them by message
+static uint8_t first_signal[STANDARD_ID_COUNT];
+static uint8_t signal_count[STANDARD_ID_COUNT];
+static signed char hex_values[256];
+
+static bool binary_output;
+static const char * output_directory = ".";
+static FILE * outputs[CAN_SIGNAL_COUNT][COLUMN_COUNT];
+
+static void build_tables(void) {
+	uint32_t i;
+
+	memset(hex_values, -1, sizeof(hex_values));
+	for (i = 0; i < 10; i++) {
+		hex_values['0' + i] = i;
+	}
+	for (i = 0; i < 6; i++) {
+		hex_values['A' + i] = 10 + i;
+		hex_values['a' + i] = 10 + i;
+	}
+
+	for (i = 0; i < CAN_SIGNAL_COUNT; i++) {
+		const uint16_t id = CAN_Signals[i].id;
+		if (signal_count[id] == 0) {
+			first_signal[id] = i;
+		}
+		signal_count[id]++;
+	}
+}
+
+static void reserve(BUFFER_T * buffer, size_t length) {
+	if (buffer->length + length <= buffer->capacity) {
+		return;
+	}
+	buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+	while (buffer->capacity < buffer->length + length) {
+		buffer->capacity *= 2;
+	}
+	buffer->data = realloc(buffer->data, buffer->capacity);
+	if (buffer->data == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void append(BUFFER_T * buffer, const void * data, size_t length) {
+	reserve(buffer, length);
+	memcpy(buffer->data + buffer->length, data, length);
+	buffer->length += length;
+}
+
+/**
+ * @details formats time,value without printf, which dominates the decode
+ * time otherwise
+ */
+static void append_csv(BUFFER_T * buffer, long long time, uint32_t value) {
+	char line[MAX_CSV_LINE];
+	char * end = line + sizeof(line);
+	char * p = end;
+	unsigned long long seconds = time / MICROS_PER_SECOND;
+	uint32_t micros = time % MICROS_PER_SECOND;
+	uint32_t i;
+
+	*--p = '\n';
+	do {
+		*--p = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+	*--p = ',';
+	for (i = 0; i < 6; i++) {
+		*--p = '0' + micros % 10;
+		micros /= 10;
+	}
+	*--p = '.';
+	do {
+		*--p = '0' + seconds % 10;
+		seconds /= 10;
+	} while (seconds != 0);
+
+	append(buffer, p, end - p);
+}
+
+/**
+ * @details parses "(seconds.fraction)" into microseconds
+ *
+ * @return the character after the closing parenthesis, NULL if malformed
+ */
+static const char * parse_time(const char * p, const char * end, long long * time) {
+	long long seconds = 0;
+	long long micros = 0;
+	uint32_t digits = 0;
+
+	if (p >= end || *p++ != '(') {
+		return NULL;
+	}
+	while (p < end && *p >= '0' && *p <= '9') {
+		seconds = seconds * 10 + (*p++ - '0');
+	}
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (digits < 6) {
+				micros = micros * 10 + (*p - '0');
+				digits++;
+			}
+			p++;
+		}
+	}
+	if (p >= end || *p++ != ')') {
+		return NULL;
+	}
+	for (; digits < 6; digits++) {
+		micros *= 10;
+	}
+	*time = seconds * MICROS_PER_SECOND + micros;
+	return p;
+}
+
+/**
+ * @details decodes one line, without its newline
+ */
+static void decode_line(CHUNK_T * chunk, const char * p, const char * end) {
+	CCAN_MSG_OBJ_T msg_obj;
+	long long time;
+	uint32_t id = 0;
+	uint32_t digits = 0;
+	uint32_t i;
+
+	p = parse_time(p, end, &time);
+	if (p == NULL) {
+		chunk->skipped++;
+		return;
+	}
+	// interface name
+	while (p < end && *p == ' ') {
+		p++;
+	}
+	while (p < end && *p != ' ') {
+		p++;
+	}
+	while (p < end && *p == ' ') {
+		p++;
+	}
+
+	while (p < end && hex_values[(unsigned char) *p] >= 0) {
+		id = (id << 4) | hex_values[(unsigned char) *p++];
+		digits++;
+	}
+	if (p >= end || *p++ != '#' || digits == 0) {
+		chunk->skipped++;
+		return;
+	}
+	chunk->frames++;
+	// extended ids have 8 digits, CAN FD frames a second '#', remote frames an 'R'
+	if (digits > 3 || id >= STANDARD_ID_COUNT || signal_count[id] == 0) {
+		return;
+	}
+
+	memset(&msg_obj, 0, sizeof(msg_obj));
+	msg_obj.mode_id = id;
+	while (end - p >= 2 && msg_obj.dlc < MAX_DLC) {
+		const int high = hex_values[(unsigned char) p[0]];
+		const int low = hex_values[(unsigned char) p[1]];
+		if (high < 0 || low < 0) {
+			break;
+		}
+		msg_obj.data[msg_obj.dlc++] = (high << 4) | low;
+		p += 2;
+	}
+	while (p < end && (*p == ' ' || *p == '\r')) {
+		p++;
+	}
+	if (p != end) {
+		return;
+	}
+
+	chunk->decoded++;
+	for (i = first_signal[id]; i < first_signal[id] + signal_count[id]; i++) {
+		uint32_t value;
+		// the frame is too short to hold it
+		if (!CAN_SignalInFrame((CAN_SIGNAL_T) i, msg_obj.dlc)) {
+			continue;
+		}
+		value = CAN_ExtractSignal(&msg_obj, (CAN_SIGNAL_T) i);
+		if (binary_output) {
+			append(&chunk->columns[i][COLUMN_TIME], &time, sizeof(time));
+			append(&chunk->columns[i][COLUMN_VALUE], &value, sizeof(value));
+		} else {
+			append_csv(&chunk->columns[i][COLUMN_CSV], time, value);
+		}
+	}
+}
+
+static void * decode_chunk(void * argument) {
+	CHUNK_T * chunk = argument;
+	const char * p = chunk->start;
+
+	while (p < chunk->end) {
+		const char * line_end = memchr(p, '\n', chunk->end - p);
+		if (line_end == NULL) {
+			line_end = chunk->end;
+		}
+		if (line_end != p) {
+			decode_line(chunk, p, line_end);
+		}
+		p = line_end + 1;
+	}
+	return NULL;
+}
+
+static FILE * open_output(uint32_t signal, COLUMN_T column) {
+	static const char * const csv_extensions[] = {"csv"};
+	static const char * const binary_extensions[] = {"time", "value"};
+	char path[4096];
+
+	if (outputs[signal][column] == NULL) {
+		snprintf(path, sizeof(path), "%s/%s.%s", output_directory, signal_names[signal],
+			binary_output ? binary_extensions[column] : csv_extensions[column]);
+		outputs[signal][column] = fopen(path, "wb");
+		if (outputs[signal][column] == NULL) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (!binary_output) {
+			fputs("time,value\n", outputs[signal][column]);
+		}
+	}
+	return outputs[signal][column];
+}
+
+/**
+ * @details appends a decoded chunk to the outputs and empties its buffers
+ * for the next round
+ */
+static void write_chunk(CHUNK_T * chunk) {
+	const uint32_t columns = binary_output ? COLUMN_COUNT : 1;
+	uint32_t signal;
+	uint32_t column;
+
+	for (signal = 0; signal < CAN_SIGNAL_COUNT; signal++) {
+		for (column = 0; column < columns; column++) {
+			BUFFER_T * buffer = &chunk->columns[signal][column];
+			if (buffer->length == 0) {
+				continue;
+			}
+			if (fwrite(buffer->data, 1, buffer->length, open_output(signal, column)) != buffer->length) {
+				fprintf(stderr, "%s: %s\n", signal_names[signal], strerror(errno));
+				exit(EXIT_FAILURE);
+			}
+			buffer->length = 0;
+		}
+	}
+}
+
+/**
+ * @return the start of the line after position, or end
+ */
+static const char * next_line(const char * position, const char * end) {
+	const char * newline;
+
+	if (position >= end) {
+		return end;
+	}
+	newline = memchr(position, '\n', end - position);
+	return newline ? newline + 1 : end;
+}
+
+static double seconds_since(const struct timeval * start) {
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: log_decode [-j threads] [-b] [-o directory] LOGFILE\n");
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char ** argv) {
+	static CHUNK_T chunks[MAX_THREADS];
+	pthread_t threads[MAX_THREADS];
+	long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long frames = 0;
+	unsigned long decoded = 0;
+	unsigned long skipped = 0;
+	struct timeval start_time;
+	struct stat status;
+	const char * log;
+	const char * log_end;
+	const char * position;
+	double elapsed;
+	long i;
+	int option;
+	int fd;
+
+	while ((option = getopt(argc, argv, "j:bo:")) != -1) {
+		switch (option) {
+			case 'j':
+				thread_count = atol(optarg);
+				break;
+			case 'b':
+				binary_output = true;
+				break;
+			case 'o':
+				output_directory = optarg;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind != argc - 1) {
+		usage();
+	}
+	if (thread_count < 1) {
+		thread_count = 1;
+	} else if (thread_count > MAX_THREADS) {
+		thread_count = MAX_THREADS;
+	}
+
+	gettimeofday(&start_time, NULL);
+	build_tables();
+
+	fd = open(argv[optind], O_RDONLY);
+	if (fd < 0 || fstat(fd, &status) != 0) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (status.st_size == 0) {
+		return EXIT_SUCCESS;
+	}
+	log = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (log == MAP_FAILED) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return EXIT_FAILURE;
+	}
+	madvise((void *) log, status.st_size, MADV_SEQUENTIAL);
+	log_end = log + status.st_size;
+
+	position = log;
+	while (position < log_end) {
+		long started = 0;
+
+		for (i = 0; i < thread_count && position < log_end; i++) {
+			chunks[i].start = position;
+			chunks[i].end = (size_t) (log_end - position) > CHUNK_BYTES ?
+				next_line(position + CHUNK_BYTES, log_end) : log_end;
+			position = chunks[i].end;
+			if (pthread_create(&threads[i], NULL, decode_chunk, &chunks[i]) != 0) {
+				// run it here instead
+				decode_chunk(&chunks[i]);
+				threads[i] = pthread_self();
+			}
+			started++;
+		}
+		for (i = 0; i < started; i++) {
+			if (!pthread_equal(threads[i], pthread_self())) {
+				pthread_join(threads[i], NULL);
+			}
+			write_chunk(&chunks[i]);
+		}
+	}
+
+	for (i = 0; i < thread_count; i++) {
+		frames += chunks[i].frames;
+		decoded += chunks[i].decoded;
+		skipped += chunks[i].skipped;
+	}
+	for (i = 0; i < CAN_SIGNAL_COUNT; i++) {
+		if (outputs[i][COLUMN_CSV] != NULL) {
+			fclose(outputs[i][COLUMN_CSV]);
+		}
+		if (outputs[i][COLUMN_VALUE] != NULL) {
+			fclose(outputs[i][COLUMN_VALUE]);
+		}
+	}
+
+	elapsed = seconds_since(&start_time);
+	fprintf(stderr, "%lu frames, %lu decoded, %lu lines skipped, %.1f MB in %.2f s (%.0f MB/s, %ld threads)\n",
+		frames, decoded, skipped, status.st_size / 1e6, elapsed,
+		status.st_size / 1e6 / (elapsed > 0 ? elapsed : 1e-9), thread_count);
+	return EXIT_SUCCESS;
+}
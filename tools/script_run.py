@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Assemble a test script, upload it to the CAN tester and run it.
+
+Usage: script_run.py PORT SCRIPT [--baud 115200] [--dump]
+
+One step per line, '#' starts a comment. Ids are hex, with more than 3
+digits sent as 29 bit ids; data is a hex string; times are in ms.
+
+    periodic SLOT PERIOD ID DATA   send DATA every PERIOD (0 stops SLOT)
+    send ID DATA                   send DATA once
+    expect ID VALUE[/MASK] TIMEOUT wait for a frame whose first bytes,
+                                   masked, equal VALUE (MASK defaults to ff..)
+    wait TIME
+
+The discharge handshake, for example:
+
+    periodic 0 100 050 40          # VCU heartbeat, Discharge
+    send 051 80                    # VCU discharge request
+    expect 061 80/80 50            # BMS discharge response, Ready
+
+--dump prints the bytecode instead of uploading it. Requires pyserial.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+OP_END = 0x00
+OP_SEND = 0x01
+OP_PERIODIC = 0x02
+OP_EXPECT = 0x03
+OP_WAIT = 0x04
+
+CAN_MSGOBJ_EXT = 0x20000000
+MAX_SIZE = 256
+PERIODIC_SLOTS = 4
+
+
+def parse_id(text):
+    value = int(text, 16)
+    if len(text) > 3:
+        return value | CAN_MSGOBJ_EXT
+    if value > 0x7FF:
+        raise ValueError('standard id out of range: %s' % text)
+    return value
+
+
+def parse_data(text):
+    data = bytes.fromhex(text)
+    if len(data) > 8:
+        raise ValueError('more than 8 data bytes: %s' % text)
+    return data
+
+
+def assemble(source):
+    code = b''
+    for number, line in enumerate(source.splitlines(), 1):
+        words = line.split('#', 1)[0].split()
+        if not words:
+            continue
+        op, args = words[0], words[1:]
+        try:
+            if op == 'send' and len(args) == 2:
+                data = parse_data(args[1])
+                code += struct.pack('>BIB', OP_SEND, parse_id(args[0]), len(data)) + data
+            elif op == 'periodic' and len(args) == 4:
+                slot = int(args[0])
+                if slot >= PERIODIC_SLOTS:
+                    raise ValueError('slot out of range: %d' % slot)
+                data = parse_data(args[3])
+                code += struct.pack('>BBHIB', OP_PERIODIC, slot, int(args[1]), parse_id(args[2]), len(data)) + data
+            elif op == 'expect' and len(args) == 3:
+                value, _, mask = args[1].partition('/')
+                value = parse_data(value)
+                mask = parse_data(mask) if mask else b'\xff' * len(value)
+                if len(mask) != len(value):
+                    raise ValueError('value and mask differ in length')
+                code += struct.pack('>BIHB', OP_EXPECT, parse_id(args[0]), int(args[2]), len(value)) + value + mask
+            elif op == 'wait' and len(args) == 1:
+                code += struct.pack('>BH', OP_WAIT, int(args[0]))
+            else:
+                raise ValueError('unrecognized step')
+        except (ValueError, struct.error) as error:
+            sys.exit('line %d: %s: %s' % (number, error, line.strip()))
+    code += bytes([OP_END])
+    if len(code) > MAX_SIZE:
+        sys.exit('script is %d bytes, the tester holds %d' % (len(code), MAX_SIZE))
+    return code
+
+
+def read_line(port, deadline):
+    line = b''
+    while time.monotonic() < deadline:
+        line += port.read(1)
+        if line.endswith(b'\n'):
+            return line.decode(errors='replace').strip()
+    raise RuntimeError('timed out waiting for the tester')
+
+
+def wait_for(port, prefixes, timeout):
+    deadline = time.monotonic() + timeout
+    while True:
+        line = read_line(port, deadline)
+        if line.startswith(prefixes):
+            return line
+
+
+def run(port, code, timeout):
+    port.reset_input_buffer()
+    port.write(b'S')
+    wait_for(port, ('Send the script',), 2)
+    port.write(struct.pack('>H', len(code)) + code + bytes([sum(code) & 0xFF]))
+    line = wait_for(port, ('Script loaded', 'Invalid script'), 2)
+    if line != 'Script loaded':
+        raise RuntimeError(line)
+    port.write(b'R')
+    while True:
+        line = wait_for(port, ('Step', 'Script'), timeout)
+        print(line)
+        if line.startswith(('Script passed', 'Script failed')):
+            return line.startswith('Script passed')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('port')
+    parser.add_argument('script')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--timeout', type=float, default=70,
+                        help='seconds to wait for each step result')
+    parser.add_argument('--dump', action='store_true')
+    args = parser.parse_args()
+
+    with open(args.script) as source:
+        code = assemble(source.read())
+    if args.dump:
+        print(code.hex())
+        return
+
+    import serial
+    with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+        sys.exit(0 if run(port, code, args.timeout) else 1)
+
+
+if __name__ == '__main__':
+    main()
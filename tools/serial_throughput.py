@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Negotiate a faster UART rate with the CAN tester and measure throughput.
+
+Usage: serial_throughput.py PORT [--baud 921600]
+
+Talks to the tester at 115200, requests the new rate with 'B', reopens the
+port at that rate, confirms with 'U', then runs the 'x' throughput test and
+compares the achieved byte rate with the theoretical 10 bits per byte limit.
+Requires pyserial.
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+BOOT_BAUD = 115200
+BAUD_KEYS = {115200: b'1', 230400: b'2', 460800: b'4', 921600: b'9'}
+
+
+def read_until(port, token, timeout):
+    deadline = time.monotonic() + timeout
+    data = b''
+    while time.monotonic() < deadline:
+        data += port.read(port.in_waiting or 1)
+        if token in data:
+            return data
+    raise RuntimeError('timed out waiting for %r, got %r' % (token, data[-80:]))
+
+
+def negotiate(port, baud):
+    port.write(b'B')
+    read_until(port, b'send \'U\'', 2)
+    port.write(BAUD_KEYS[baud])
+    read_until(port, b'BAUD', 2)
+    # a refused rate is reported at the old rate right after the BAUD line
+    time.sleep(0.1)
+    if b'ERR' in port.read(port.in_waiting):
+        raise RuntimeError('tester refused %d baud' % baud)
+    port.baudrate = baud
+    port.reset_input_buffer()
+    port.write(b'U')
+    read_until(port, b'OK', 2)
+
+
+def measure(port):
+    port.reset_input_buffer()
+    start = time.monotonic()
+    port.write(b'x')
+    data = read_until(port, b' ms\r\n', 30)
+    elapsed = time.monotonic() - start
+    header, rest = data.split(b'START ', 1)[1].split(b'\r\n', 1)
+    payload, trailer = rest.rsplit(b'END ', 1)
+    return int(header), len(payload), elapsed, int(trailer.split()[0])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('port')
+    parser.add_argument('--baud', type=int, default=921600, choices=sorted(BAUD_KEYS))
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, BOOT_BAUD, timeout=0.1) as port:
+        if args.baud != BOOT_BAUD:
+            negotiate(port, args.baud)
+        expected, received, elapsed, tester_ms = measure(port)
+
+    achieved = received / elapsed
+    limit = args.baud / 10.0
+    print('baud %d: received %d/%d bytes in %.3f s (tester %d ms)'
+          % (args.baud, received, expected, elapsed, tester_ms))
+    print('achieved %.0f B/s, %.1f%% of the %.0f B/s line limit'
+          % (achieved, 100.0 * achieved / limit, limit))
+    return 0 if received == expected else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Poll the latest signal values from the CAN tester's signal table.
+
+Usage: signal_query.py PORT [SIGNAL ...] [--baud 921600] [--period 0.1]
+
+Signals are named MESSAGE.SIGNAL as in can_constants.h, for example
+BMS_PACK_STATUS.PACK_VOLTAGE; without any, every signal is polled. Puts
+the tester in gateway mode with the binary protocol, channel closed, and
+sends a query (see inc/slcan.h) every --period seconds, printing one line
+per signal:
+
+    BMS_PACK_STATUS.PACK_VOLTAGE 812 (35 ms ago)
+
+Signal numbers follow the CAN_SIGNALS list in inc/can_utils.h, which is
+read from the source tree. Requires pyserial.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import time
+
+QUERY = 0xAE
+NEVER_RECEIVED = 0x80
+ENTRY_SIZE = 9
+
+CAN_UTILS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'inc', 'can_utils.h')
+
+
+def load_signal_names(path=CAN_UTILS_H):
+    with open(path) as header:
+        text = header.read()
+    listing = text[text.index('#define CAN_SIGNALS(X)'):]
+    listing = listing[:listing.index('\n\n')]
+    return ['%s.%s' % pair for pair in re.findall(r'X\((\w+), (\w+)\)', listing)]
+
+
+def start_gateway(port):
+    port.write(b'\x1b')
+    time.sleep(0.1)
+    port.write(b'G')
+    time.sleep(0.1)
+    port.write(b'b')
+    time.sleep(0.1)
+    port.reset_input_buffer()
+
+
+def read_answer(port, count):
+    """Reads an answer, skipping anything sent before it."""
+    deadline = time.time() + 1
+    data = b''
+    while time.time() < deadline:
+        data += port.read(port.in_waiting or 1)
+        start = data.find(bytes([QUERY]))
+        if start < 0:
+            data = b''
+            continue
+        data = data[start:]
+        size = 1 + 4 + 1 + count * ENTRY_SIZE
+        if len(data) >= size:
+            return data[:size]
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('port')
+    parser.add_argument('signals', nargs='*')
+    parser.add_argument('--baud', type=int, default=921600)
+    parser.add_argument('--period', type=float, default=0.1)
+    args = parser.parse_args()
+
+    names = load_signal_names()
+    try:
+        numbers = [names.index(name) for name in args.signals] or list(range(len(names)))
+    except ValueError as error:
+        sys.exit('unknown signal: %s' % error)
+
+    import serial
+    port = serial.Serial(args.port, args.baud, timeout=0.01)
+    start_gateway(port)
+    request = bytes([QUERY, len(numbers)] + numbers)
+
+    try:
+        while True:
+            port.write(request)
+            answer = read_answer(port, len(numbers))
+            if answer is None:
+                sys.stderr.write('no answer\n')
+                continue
+            now, count = struct.unpack('>IB', answer[1:6])
+            for i in range(count):
+                entry = answer[6 + i * ENTRY_SIZE:6 + (i + 1) * ENTRY_SIZE]
+                signal, value, updated = struct.unpack('>BII', entry)
+                name = names[signal & ~NEVER_RECEIVED]
+                if signal & NEVER_RECEIVED:
+                    print('%s -' % name)
+                else:
+                    print('%s %d (%d ms ago)' % (name, value, (now - updated) & 0xFFFFFFFF))
+            print()
+            time.sleep(args.period)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        port.write(bytes([0xA5]) + b'\x1b')
+        port.close()
+
+
+if __name__ == '__main__':
+    main()
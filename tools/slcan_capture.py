@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""Capture CAN frames through the tester's SLCAN gateway in host time.
+
+Usage: slcan_capture.py PORT [--baud 921600] [--bitrate 500000] [-o FILE]
+
+Puts the tester in gateway mode with the binary protocol and microsecond
+timestamps (see inc/slcan.h), pings it every --ping-interval seconds and
+writes received frames in candump log format,
+
+    (1697712345.123456) can0 123#DEADBEEF
+
+with the tester timestamps converted to host wall-clock time.
+
+Each ping gives the classic four timestamps: host send t0, tester receive
+t1, tester send t2 and host receive t3. The offset between the clocks is
+((t1 - t0) + (t2 - t3)) / 2, off by at most half the round trip. Only the
+quarter of pings with the shortest round trips are kept, and a straight
+line fitted through their offsets over the tester clock tracks the drift
+between the two crystals over long runs.
+
+USB serial adapters hold received bytes back for up to their latency
+timer; set it to 1 ms (e.g. /sys/bus/usb-serial/devices/*/latency_timer)
+for sub-millisecond alignment. Requires pyserial.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+BITRATES = [10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000]
+
+FRAME = 0xAA
+SYNC = 0xAB
+PING = 0xAC
+PONG = 0xAD
+FLAG_EXT = 0x80
+FLAG_RTR = 0x40
+FLAG_DLC = 0x0F
+
+# the tester's receive interrupt fires about 4 character times after a lone
+# byte, see Serial_LastRxCycles
+RX_TIMEOUT_CHARACTERS = 4
+BITS_PER_CHARACTER = 10
+
+KEPT_FRACTION = 0.25
+MAX_SAMPLES = 256
+
+
+class ClockModel:
+    """Least squares fit of host minus tester time over the tester clock."""
+
+    def __init__(self):
+        self.samples = []
+
+    def add(self, t0, t1, t2, t3):
+        offset = ((t1 - t0) + (t2 - t3)) / 2
+        round_trip = (t3 - t0) - (t2 - t1)
+        self.samples.append((t1, -offset, round_trip))
+        del self.samples[:-MAX_SAMPLES]
+
+    def ready(self):
+        return len(self.samples) > 0
+
+    def fit(self):
+        kept = sorted(self.samples, key=lambda sample: sample[2])
+        kept = kept[:max(1, int(len(kept) * KEPT_FRACTION))]
+        n = len(kept)
+        mean_x = sum(sample[0] for sample in kept) / n
+        mean_y = sum(sample[1] for sample in kept) / n
+        sxx = sum((sample[0] - mean_x) ** 2 for sample in kept)
+        if n < 2 or sxx == 0:
+            return mean_y, 0.0, mean_x, kept[0][2]
+        slope = sum((sample[0] - mean_x) * (sample[1] - mean_y) for sample in kept) / sxx
+        return mean_y, slope, mean_x, kept[0][2]
+
+    def to_host(self, tester_time):
+        offset, drift, center, _ = self.fit()
+        return tester_time + offset + drift * (tester_time - center)
+
+
+class Reader:
+    """Splits the binary stream into frames, sync records and pongs."""
+
+    def __init__(self, port):
+        self.port = port
+        self.buffer = b''
+
+    def fill(self):
+        data = self.port.read(self.port.in_waiting or 1)
+        now = time.time()
+        self.buffer += data
+        return now
+
+    def take(self, size):
+        if len(self.buffer) < size:
+            return None
+        data, self.buffer = self.buffer[:size], self.buffer[size:]
+        return data
+
+    def next(self):
+        while self.buffer:
+            kind = self.buffer[0]
+            if kind == FRAME:
+                if len(self.buffer) < 2:
+                    return None
+                flags = self.buffer[1]
+                size = 2 + (4 if flags & FLAG_EXT else 2) + 4
+                if not flags & FLAG_RTR:
+                    size += flags & FLAG_DLC
+                data = self.take(size)
+                return ('frame', data) if data else None
+            if kind == SYNC:
+                data = self.take(9)
+                return ('sync', struct.unpack('>Q', data[1:])[0]) if data else None
+            if kind == PONG:
+                data = self.take(17)
+                return ('pong', struct.unpack('>QQ', data[1:])) if data else None
+            # replies to the setup commands and line noise
+            self.buffer = self.buffer[1:]
+        return None
+
+
+def decode_frame(data):
+    flags = data[1]
+    if flags & FLAG_EXT:
+        can_id = struct.unpack('>I', data[2:6])[0]
+        text_id = '%08X' % can_id
+        rest = data[6:]
+    else:
+        can_id = struct.unpack('>H', data[2:4])[0]
+        text_id = '%03X' % can_id
+        rest = data[4:]
+    if flags & FLAG_RTR:
+        payload = 'R'
+    else:
+        payload = rest[:flags & FLAG_DLC].hex().upper()
+        rest = rest[flags & FLAG_DLC:]
+    return '%s#%s' % (text_id, payload), struct.unpack('>I', rest)[0]
+
+
+def start_gateway(port, bitrate):
+    port.write(b'\x1b')
+    time.sleep(0.1)
+    port.write(b'G')
+    time.sleep(0.1)
+    port.write(b'C\rS%d\rZ2\rO\rb' % BITRATES.index(bitrate))
+    time.sleep(0.1)
+    port.reset_input_buffer()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('port')
+    parser.add_argument('--baud', type=int, default=921600)
+    parser.add_argument('--bitrate', type=int, default=500000, choices=BITRATES)
+    parser.add_argument('--interface', default='can0')
+    parser.add_argument('--ping-interval', type=float, default=0.5)
+    parser.add_argument('-o', '--output', type=argparse.FileType('w'), default=sys.stdout)
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baud, timeout=0.01)
+    start_gateway(port, args.bitrate)
+    rx_delay = RX_TIMEOUT_CHARACTERS * BITS_PER_CHARACTER / args.baud
+    pong_duration = 17 * BITS_PER_CHARACTER / args.baud
+
+    reader = Reader(port)
+    model = ClockModel()
+    # the latest sync record extends the 32 bit frame timestamps
+    base_us = None
+    pending = []
+    ping_sent = None
+    next_ping = 0.0
+
+    try:
+        while True:
+            now = time.time()
+            if ping_sent is None and now >= next_ping:
+                ping_sent = time.time()
+                port.write(bytes([PING]))
+                next_ping = ping_sent + args.ping_interval
+
+            received = reader.fill()
+            while True:
+                record = reader.next()
+                if record is None:
+                    break
+                kind, value = record
+                if kind == 'pong' and ping_sent is not None:
+                    # t3 is when the last pong byte arrived, move it to the first
+                    t1 = value[0] / 1e6 - rx_delay
+                    model.add(ping_sent, t1, value[1] / 1e6, received - pong_duration)
+                    ping_sent = None
+                elif kind == 'sync':
+                    base_us = value
+                elif kind == 'frame':
+                    pending.append(decode_frame(value))
+
+            if not model.ready() or base_us is None:
+                continue
+            for text, low_us in pending:
+                # pick the 2^32 period closest to the last sync record
+                tester_us = (base_us & ~0xFFFFFFFF) | low_us
+                if tester_us - base_us > 1 << 31:
+                    tester_us -= 1 << 32
+                elif base_us - tester_us > 1 << 31:
+                    tester_us += 1 << 32
+                host_time = model.to_host(tester_us / 1e6)
+                args.output.write('(%.6f) %s %s\n' % (host_time, args.interface, text))
+            pending = []
+    except KeyboardInterrupt:
+        pass
+    finally:
+        port.write(bytes([0xA5]) + b'C\r\x1b')
+        port.close()
+
+    if model.ready():
+        offset, drift, _, round_trip = model.fit()
+        sys.stderr.write('offset %.6f s, drift %.2f ppm, best round trip %.0f us\n' %
+                         (offset, drift * 1e6, round_trip * 1e6))
+
+
+if __name__ == '__main__':
+    main()